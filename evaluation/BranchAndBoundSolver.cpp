@@ -0,0 +1,689 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include <inference/LinearConstraints.h>
+#include <inference/LinearObjective.h>
+#include <util/exceptions.h>
+#include <util/Logger.h>
+#include "BranchAndBoundSolver.h"
+
+logger::LogChannel branchandboundlog("branchandboundlog", "[BranchAndBoundSolver] ");
+
+namespace {
+
+const double Infinity = std::numeric_limits<double>::infinity();
+
+// tolerance for comparisons of bounds and activities
+const double Epsilon = 1e-6;
+
+} // anonymous namespace
+
+BranchAndBoundSolver::BranchAndBoundSolver() :
+	_numVariables(0),
+	_constant(0),
+	_maximize(false),
+	_incumbentValue(Infinity),
+	_openBound(Infinity),
+	_bestBound(-Infinity),
+	_timeout(0),
+	_gap(0),
+	_absoluteGap(false),
+	_verbose(false),
+	_numNodes(0),
+	_timedOut(false) {
+
+	_rowBegins.push_back(0);
+}
+
+void
+BranchAndBoundSolver::initialize(
+		unsigned int numVariables,
+		VariableType variableType) {
+
+	initialize(numVariables, variableType, std::map<unsigned int, VariableType>());
+}
+
+void
+BranchAndBoundSolver::initialize(
+		unsigned int numVariables,
+		VariableType defaultVariableType,
+		const std::map<unsigned int, VariableType>& specialVariableTypes) {
+
+	_numVariables = numVariables;
+	_variableTypes.assign(numVariables, defaultVariableType);
+	for (const auto& p : specialVariableTypes)
+		_variableTypes[p.first] = p.second;
+
+	for (VariableType type : _variableTypes)
+		if (type == Continuous)
+			UTIL_THROW_EXCEPTION(
+					UsageError,
+					"the branch-and-bound solver supports only binary and integer variables");
+
+	_objective.assign(numVariables, 0);
+	_constant = 0;
+	_maximize = false;
+
+	setConstraints(LinearConstraints());
+
+	_startSolutions.clear();
+}
+
+void
+BranchAndBoundSolver::setObjective(const LinearObjective& objective) {
+
+	_maximize = (objective.getSense() == Maximize);
+	_constant = (_maximize ? -objective.getConstant() : objective.getConstant());
+
+	_objective.assign(_numVariables, 0);
+	const std::vector<double>& coefs = objective.getCoefficients();
+	for (unsigned int i = 0; i < std::min<size_t>(coefs.size(), _numVariables); i++)
+		_objective[i] = (_maximize ? -coefs[i] : coefs[i]);
+}
+
+void
+BranchAndBoundSolver::setConstraints(const LinearConstraints& constraints) {
+
+	_rowBegins.assign(1, 0);
+	_rowVars.clear();
+	_rowCoefs.clear();
+	_rowLower.clear();
+	_rowUpper.clear();
+
+	for (const LinearConstraint& constraint : constraints)
+		addConstraint(constraint);
+}
+
+void
+BranchAndBoundSolver::setConstraints(const SparseConstraints& constraints) {
+
+	_rowBegins.assign(1, 0);
+	_rowVars.clear();
+	_rowCoefs.clear();
+	_rowLower.clear();
+	_rowUpper.clear();
+
+	_rowBegins.reserve(constraints.size() + 1);
+	_rowVars.reserve(constraints.getNumNonZeros());
+	_rowCoefs.reserve(constraints.getNumNonZeros());
+	_rowLower.reserve(constraints.size());
+	_rowUpper.reserve(constraints.size());
+
+	const std::vector<unsigned int>& columns = constraints.getColumns();
+	const std::vector<double>& values = constraints.getValues();
+
+	for (unsigned int row = 0; row < constraints.size(); row++) {
+
+		for (unsigned int k = constraints.getRowBegin(row); k < constraints.getRowEnd(row); k++)
+			addCoefficient(columns[k], values[k]);
+
+		addRow(constraints.getRelation(row), constraints.getRhs(row));
+	}
+}
+
+void
+BranchAndBoundSolver::addConstraint(const LinearConstraint& constraint) {
+
+	for (const auto& p : constraint.getCoefficients())
+		addCoefficient(p.first, p.second);
+
+	addRow(constraint.getRelation(), constraint.getValue());
+}
+
+void
+BranchAndBoundSolver::addCoefficient(unsigned int var, double coef) {
+
+	if (coef == 0)
+		return;
+
+	if (var >= _numVariables)
+		UTIL_THROW_EXCEPTION(
+				UsageError,
+				"constraint refers to variable " << var << ", but only " << _numVariables << " variables are initialized");
+
+	_rowVars.push_back(var);
+	_rowCoefs.push_back(coef);
+}
+
+void
+BranchAndBoundSolver::addRow(Relation relation, double value) {
+
+	_rowBegins.push_back(_rowVars.size());
+
+	switch (relation) {
+
+	case LessEqual:
+		_rowLower.push_back(-Infinity);
+		_rowUpper.push_back(value);
+		break;
+	case Equal:
+		_rowLower.push_back(value);
+		_rowUpper.push_back(value);
+		break;
+	case GreaterEqual:
+		_rowLower.push_back(value);
+		_rowUpper.push_back(Infinity);
+		break;
+	}
+}
+
+void
+BranchAndBoundSolver::addStartSolution(const Solution& solution) {
+
+	std::vector<double> values(_numVariables, 0);
+	for (unsigned int var = 0; var < std::min(solution.size(), _numVariables); var++)
+		values[var] = solution[var];
+
+	_startSolutions.push_back(values);
+}
+
+bool
+BranchAndBoundSolver::solve(Solution& solution, std::string& message) {
+
+	_start = std::chrono::steady_clock::now();
+	_numNodes = 0;
+	_timedOut = false;
+	_openBound = Infinity;
+
+	unsigned int numRows = _rowLower.size();
+
+	// find the rows of each variable
+
+	std::vector<unsigned int> numColumnRows(_numVariables, 0);
+	for (unsigned int var : _rowVars)
+		numColumnRows[var]++;
+
+	_columnBegins.assign(_numVariables + 1, 0);
+	for (unsigned int var = 0; var < _numVariables; var++)
+		_columnBegins[var + 1] = _columnBegins[var] + numColumnRows[var];
+
+	_columnRows.resize(_rowVars.size());
+	std::vector<unsigned int> next(_columnBegins.begin(), _columnBegins.end() - 1);
+	for (unsigned int row = 0; row < numRows; row++)
+		for (unsigned int k = _rowBegins[row]; k < _rowBegins[row + 1]; k++)
+			_columnRows[next[_rowVars[k]]++] = row;
+
+	// find the choice rows, and order their variables by objective
+
+	_choiceRows.clear();
+	_choiceOrders.clear();
+	for (unsigned int row = 0; row < numRows; row++) {
+
+		if (_rowLower[row] != 1 || _rowUpper[row] != 1 || _rowBegins[row + 1] - _rowBegins[row] < 2)
+			continue;
+
+		bool isChoice = true;
+		for (unsigned int k = _rowBegins[row]; k < _rowBegins[row + 1]; k++)
+			if (_rowCoefs[k] != 1 || _variableTypes[_rowVars[k]] != Binary)
+				isChoice = false;
+
+		if (!isChoice)
+			continue;
+
+		std::vector<unsigned int> order(_rowVars.begin() + _rowBegins[row], _rowVars.begin() + _rowBegins[row + 1]);
+		std::stable_sort(
+				order.begin(),
+				order.end(),
+				[this](unsigned int a, unsigned int b) { return _objective[a] < _objective[b]; });
+
+		_choiceRows.push_back(row);
+		_choiceOrders.push_back(order);
+	}
+
+	// initial bounds
+
+	_lower.resize(_numVariables);
+	_upper.resize(_numVariables);
+	for (unsigned int var = 0; var < _numVariables; var++) {
+
+		_lower[var] = (_variableTypes[var] == Binary ? 0 : -Infinity);
+		_upper[var] = (_variableTypes[var] == Binary ? 1 :  Infinity);
+	}
+	_trail.clear();
+
+	_queue.clear();
+	_queued.assign(numRows, true);
+	for (unsigned int row = numRows; row > 0; row--)
+		_queue.push_back(row - 1);
+
+	_incumbent.clear();
+	_incumbentValue = Infinity;
+
+	// the best start solution is the first incumbent
+	for (const std::vector<double>& values : _startSolutions) {
+
+		if (!isFeasible(values)) {
+
+			LOG_DEBUG(branchandboundlog) << "ignoring infeasible start solution" << std::endl;
+			continue;
+		}
+
+		double value = getValue(values);
+		if (value < _incumbentValue) {
+
+			_incumbent = values;
+			_incumbentValue = value;
+		}
+	}
+
+	if (!_incumbent.empty())
+		LOG_DEBUG(branchandboundlog)
+				<< "starting from a solution with value "
+				<< (_maximize ? -_incumbentValue : _incumbentValue)
+				<< std::endl;
+
+	LOG_DEBUG(branchandboundlog)
+			<< "solving with " << _numVariables << " variables, "
+			<< numRows << " constraints, and "
+			<< _choiceRows.size() << " choice constraints"
+			<< std::endl;
+
+	if (propagate())
+		search(0);
+	backtrack(0);
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - _start).count();
+
+	// all branches that were explored or pruned can not improve over the 
+	// incumbent by more than the gap
+	_bestBound = _openBound;
+	if (!_incumbent.empty()) {
+
+		double tolerance = (_absoluteGap ? _gap : _gap*std::abs(_incumbentValue));
+		_bestBound = std::min(_bestBound, _incumbentValue - tolerance);
+	}
+
+	LOG_DEBUG(branchandboundlog)
+			<< "explored " << _numNodes << " nodes in " << seconds << "s, "
+			<< "best bound is " << getBestBound()
+			<< std::endl;
+
+	if (_incumbent.empty()) {
+
+		message = (_timedOut ? "timeout before a feasible solution was found" : "problem is infeasible");
+		return false;
+	}
+
+	solution.resize(_numVariables);
+	for (unsigned int var = 0; var < _numVariables; var++)
+		solution[var] = _incumbent[var];
+
+	if (_timedOut) {
+
+		message = "timeout after " + std::to_string(_numNodes) + " nodes, solution might not be optimal";
+		return false;
+	}
+
+	message = "optimal solution found after " + std::to_string(_numNodes) + " nodes";
+	return true;
+}
+
+void
+BranchAndBoundSolver::search(unsigned int choiceBegin) {
+
+	_numNodes++;
+
+	if (_timedOut || ((_numNodes & 255) == 0 && isTimeout())) {
+
+		_openBound = std::min(_openBound, getBound());
+		return;
+	}
+
+	if (!canImprove(getBound()))
+		return;
+
+	// find the next choice row that has no variable set to one yet
+	for (; choiceBegin < _choiceRows.size(); choiceBegin++) {
+
+		bool open = true;
+		for (unsigned int var : _choiceOrders[choiceBegin])
+			if (_lower[var] > 0.5)
+				open = false;
+
+		if (open)
+			break;
+	}
+
+	// branch on the variable that is set to one
+	if (choiceBegin < _choiceRows.size()) {
+
+		const std::vector<unsigned int>& order = _choiceOrders[choiceBegin];
+		size_t trailSize = _trail.size();
+
+		for (unsigned int i = 0; i < order.size(); i++) {
+
+			if (_upper[order[i]] < 0.5)
+				continue;
+
+			if (setLower(order[i], 1) && propagate())
+				search(choiceBegin + 1);
+			backtrack(trailSize);
+
+			if (!_timedOut)
+				continue;
+
+			// remember the bounds of the branches we did not get to
+			for (unsigned int j = i + 1; j < order.size(); j++) {
+
+				if (_upper[order[j]] < 0.5)
+					continue;
+
+				if (setLower(order[j], 1) && propagate())
+					_openBound = std::min(_openBound, getBound());
+				backtrack(trailSize);
+			}
+
+			return;
+		}
+
+		return;
+	}
+
+	// all choices are made, branch on the remaining free variables
+	for (unsigned int var = 0; var < _numVariables; var++)
+		if (_lower[var] < _upper[var]) {
+
+			branchOnVariable(var, choiceBegin);
+			return;
+		}
+
+	// all variables are fixed, we found a better solution
+
+	double value = getValue(_lower);
+
+	_incumbent = _lower;
+	_incumbentValue = value;
+
+	if (_verbose)
+		LOG_USER(branchandboundlog)
+				<< "found solution with value " << (_maximize ? -value : value)
+				<< " after " << _numNodes << " nodes"
+				<< std::endl;
+}
+
+void
+BranchAndBoundSolver::branchOnVariable(unsigned int var, unsigned int choiceBegin) {
+
+	// try the finite bound preferred by the objective first, and exclude it in 
+	// the other branches
+
+	bool lowerFinite = !std::isinf(_lower[var]);
+	bool upperFinite = !std::isinf(_upper[var]);
+
+	double value = 0;
+	bool excludeBelow = true;
+	bool excludeAbove = true;
+
+	if (lowerFinite && (_objective[var] >= 0 || !upperFinite)) {
+
+		value = _lower[var];
+		excludeBelow = false;
+
+	} else if (upperFinite) {
+
+		value = _upper[var];
+		excludeAbove = false;
+	}
+
+	size_t trailSize = _trail.size();
+
+	if (setLower(var, value) && setUpper(var, value) && propagate())
+		search(choiceBegin);
+	backtrack(trailSize);
+
+	// the bound of this node covers the branches we did not get to
+	if (_timedOut) {
+
+		_openBound = std::min(_openBound, getBound());
+		return;
+	}
+
+	if (excludeAbove) {
+
+		if (setLower(var, value + 1) && propagate())
+			search(choiceBegin);
+		backtrack(trailSize);
+	}
+
+	if (_timedOut) {
+
+		_openBound = std::min(_openBound, getBound());
+		return;
+	}
+
+	if (excludeBelow) {
+
+		if (setUpper(var, value - 1) && propagate())
+			search(choiceBegin);
+		backtrack(trailSize);
+	}
+}
+
+bool
+BranchAndBoundSolver::propagate() {
+
+	while (!_queue.empty()) {
+
+		unsigned int row = _queue.back();
+		_queue.pop_back();
+		_queued[row] = false;
+
+		unsigned int begin = _rowBegins[row];
+		unsigned int end   = _rowBegins[row + 1];
+
+		// the minimal and maximal activity of the row, without infinite
+		// contributions, which are counted separately
+		double minActivity = 0;
+		double maxActivity = 0;
+		unsigned int numMinInfinite = 0;
+		unsigned int numMaxInfinite = 0;
+
+		for (unsigned int k = begin; k < end; k++) {
+
+			double coef = _rowCoefs[k];
+			double lower = (coef > 0 ? _lower[_rowVars[k]] : _upper[_rowVars[k]]);
+			double upper = (coef > 0 ? _upper[_rowVars[k]] : _lower[_rowVars[k]]);
+
+			if (std::isinf(lower)) numMinInfinite++; else minActivity += coef*lower;
+			if (std::isinf(upper)) numMaxInfinite++; else maxActivity += coef*upper;
+		}
+
+		bool feasible = true;
+
+		if (numMinInfinite == 0 && minActivity > _rowUpper[row] + Epsilon)
+			feasible = false;
+		if (numMaxInfinite == 0 && maxActivity < _rowLower[row] - Epsilon)
+			feasible = false;
+
+		// tighten the bounds of each variable, given the activity of the others
+		for (unsigned int k = begin; feasible && k < end; k++) {
+
+			unsigned int var = _rowVars[k];
+			double coef = _rowCoefs[k];
+			double lower = (coef > 0 ? _lower[var] : _upper[var]);
+			double upper = (coef > 0 ? _upper[var] : _lower[var]);
+
+			if (!std::isinf(_rowUpper[row])) {
+
+				bool infinite = std::isinf(lower);
+				if (numMinInfinite == (infinite ? 1 : 0)) {
+
+					double rest = minActivity - (infinite ? 0 : coef*lower);
+					double bound = (_rowUpper[row] - rest)/coef;
+
+					feasible = (coef > 0 ? setUpper(var, bound) : setLower(var, bound));
+				}
+			}
+
+			if (feasible && !std::isinf(_rowLower[row])) {
+
+				bool infinite = std::isinf(upper);
+				if (numMaxInfinite == (infinite ? 1 : 0)) {
+
+					double rest = maxActivity - (infinite ? 0 : coef*upper);
+					double bound = (_rowLower[row] - rest)/coef;
+
+					feasible = (coef > 0 ? setLower(var, bound) : setUpper(var, bound));
+				}
+			}
+		}
+
+		if (!feasible) {
+
+			for (unsigned int r : _queue)
+				_queued[r] = false;
+			_queue.clear();
+
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool
+BranchAndBoundSolver::setLower(unsigned int var, double value) {
+
+	// all variables are integer
+	value = std::ceil(value - Epsilon);
+
+	if (value <= _lower[var])
+		return true;
+
+	_trail.push_back(BoundChange{var, _lower[var], _upper[var]});
+	_lower[var] = value;
+
+	if (value > _upper[var])
+		return false;
+
+	queueRows(var);
+	return true;
+}
+
+bool
+BranchAndBoundSolver::setUpper(unsigned int var, double value) {
+
+	value = std::floor(value + Epsilon);
+
+	if (value >= _upper[var])
+		return true;
+
+	_trail.push_back(BoundChange{var, _lower[var], _upper[var]});
+	_upper[var] = value;
+
+	if (value < _lower[var])
+		return false;
+
+	queueRows(var);
+	return true;
+}
+
+void
+BranchAndBoundSolver::queueRows(unsigned int var) {
+
+	for (unsigned int i = _columnBegins[var]; i < _columnBegins[var + 1]; i++) {
+
+		unsigned int row = _columnRows[i];
+
+		if (!_queued[row]) {
+
+			_queued[row] = true;
+			_queue.push_back(row);
+		}
+	}
+}
+
+void
+BranchAndBoundSolver::backtrack(size_t trailSize) {
+
+	while (_trail.size() > trailSize) {
+
+		const BoundChange& change = _trail.back();
+		_lower[change.var] = change.lower;
+		_upper[change.var] = change.upper;
+		_trail.pop_back();
+	}
+}
+
+bool
+BranchAndBoundSolver::isFeasible(const std::vector<double>& values) const {
+
+	for (unsigned int var = 0; var < _numVariables; var++) {
+
+		double value = values[var];
+
+		if (std::abs(value - std::round(value)) > Epsilon)
+			return false;
+		if (_variableTypes[var] == Binary && (value < -Epsilon || value > 1 + Epsilon))
+			return false;
+	}
+
+	for (unsigned int row = 0; row < _rowLower.size(); row++) {
+
+		double activity = 0;
+		for (unsigned int k = _rowBegins[row]; k < _rowBegins[row + 1]; k++)
+			activity += _rowCoefs[k]*values[_rowVars[k]];
+
+		if (activity < _rowLower[row] - Epsilon || activity > _rowUpper[row] + Epsilon)
+			return false;
+	}
+
+	return true;
+}
+
+double
+BranchAndBoundSolver::getValue(const std::vector<double>& values) const {
+
+	double value = _constant;
+	for (unsigned int var = 0; var < _numVariables; var++)
+		value += _objective[var]*values[var];
+
+	return value;
+}
+
+double
+BranchAndBoundSolver::getBound() const {
+
+	double bound = _constant;
+
+	for (unsigned int var = 0; var < _numVariables; var++) {
+
+		double coef = _objective[var];
+
+		if (coef > 0)
+			bound += coef*_lower[var];
+		else if (coef < 0)
+			bound += coef*_upper[var];
+	}
+
+	// unbounded variables give -inf
+	if (_boundFunction && !_maximize)
+		bound = std::max(bound, _boundFunction(_lower, _upper));
+
+	return bound;
+}
+
+bool
+BranchAndBoundSolver::canImprove(double bound) const {
+
+	if (_incumbent.empty())
+		return true;
+
+	double tolerance = (_absoluteGap ? _gap : _gap*std::abs(_incumbentValue));
+
+	return bound < _incumbentValue - tolerance - 1e-9;
+}
+
+bool
+BranchAndBoundSolver::isTimeout() {
+
+	if (_timeout <= 0)
+		return false;
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - _start).count();
+	if (seconds > _timeout)
+		_timedOut = true;
+
+	return _timedOut;
+}
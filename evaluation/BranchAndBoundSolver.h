@@ -0,0 +1,210 @@
+#ifndef TED_EVALUATION_BRANCH_AND_BOUND_SOLVER_H__
+#define TED_EVALUATION_BRANCH_AND_BOUND_SOLVER_H__
+
+#include <chrono>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <inference/LinearSolverBackend.h>
+#include "SparseConstraints.h"
+
+/**
+ * An in-tree branch-and-bound solver for the small integer linear programs
+ * of TED and detection overlap, to be used instead of an external solver.
+ *
+ * The solver is specialised to assignment problems: Equality constraints with
+ * unit coefficients over binary variables and a right hand side of one (e.g.,
+ * "every cell takes exactly one label") are branched on as a whole, trying the
+ * variables in order of increasing objective coefficients. All other variables
+ * follow by bound propagation over the constraints (e.g., match indicators and
+ * the number of matches per label), or are branched on individually.
+ *
+ * Lower bounds are obtained from the propagated variable bounds, and from an
+ * optional problem-specific bound function (see setBoundFunction()).
+ *
+ * Only binary and integer variables are supported.
+ */
+class BranchAndBoundSolver : public LinearSolverBackend {
+
+public:
+
+	/**
+	 * A function that computes a lower bound of the objective (for 
+	 * minimization, including the constant) over all solutions within the 
+	 * given lower and upper variable bounds.
+	 */
+	typedef std::function<double(const std::vector<double>& lower, const std::vector<double>& upper)> BoundFunction;
+
+	BranchAndBoundSolver();
+
+	/**
+	 * Set a problem-specific lower bound to prune the search with, in 
+	 * addition to the bound given by the propagated variable bounds.
+	 */
+	void setBoundFunction(BoundFunction boundFunction) { _boundFunction = boundFunction; }
+
+	/**
+	 * Add a known solution to start from. The best feasible start solution 
+	 * becomes the initial incumbent, such that the search only explores nodes 
+	 * that can improve over it. Infeasible start solutions are ignored.
+	 */
+	void addStartSolution(const Solution& solution);
+
+	void initialize(
+			unsigned int numVariables,
+			VariableType variableType) override;
+
+	void initialize(
+			unsigned int numVariables,
+			VariableType defaultVariableType,
+			const std::map<unsigned int, VariableType>& specialVariableTypes) override;
+
+	void setObjective(const LinearObjective& objective) override;
+
+	void setConstraints(const LinearConstraints& constraints) override;
+
+	/**
+	 * Set the constraints from a sparse matrix, without converting each row 
+	 * into a LinearConstraint.
+	 */
+	void setConstraints(const SparseConstraints& constraints);
+
+	void addConstraint(const LinearConstraint& constraint) override;
+
+	void setTimeout(double timeout) override { _timeout = timeout; }
+
+	void setOptimalityGap(double gap, bool absolute = false) override {
+
+		_gap = gap;
+		_absoluteGap = absolute;
+	}
+
+	// the search is single-threaded, TED solves components in parallel instead
+	void setNumThreads(unsigned int /*numThreads*/) override {}
+
+	void setVerbose(bool verbose) override { _verbose = verbose; }
+
+	bool solve(Solution& solution, std::string& message) override;
+
+	/**
+	 * After solve(), get the best proven bound of the objective, i.e., a 
+	 * lower bound for minimization and an upper bound for maximization. If 
+	 * the search was not interrupted, this is the value of the solution (up 
+	 * to the optimality gap).
+	 */
+	double getBestBound() const { return (_maximize ? -_bestBound : _bestBound); }
+
+private:
+
+	// a change of the bounds of a variable, to be undone on backtracking
+	struct BoundChange {
+
+		unsigned int var;
+		double lower;
+		double upper;
+	};
+
+	// add a coefficient to the row under construction, and finish the row 
+	// with the given relation and right hand side
+	void addCoefficient(unsigned int var, double coef);
+	void addRow(Relation relation, double value);
+
+	// depth-first search below the current node, branching on the choice rows
+	// starting at the given one first
+	void search(unsigned int choiceBegin);
+
+	// branch on all possible values of the given variable
+	void branchOnVariable(unsigned int var, unsigned int choiceBegin);
+
+	// propagate the bounds of all variables in the queued rows, returns false
+	// if the current node is infeasible
+	bool propagate();
+
+	// tighten the bounds of a variable, returns false if they become empty
+	bool setLower(unsigned int var, double value);
+	bool setUpper(unsigned int var, double value);
+
+	// queue all rows of a variable for propagation
+	void queueRows(unsigned int var);
+
+	// undo all bound changes up to the given trail size
+	void backtrack(size_t trailSize);
+
+	// check whether the given values satisfy all bounds and constraints
+	bool isFeasible(const std::vector<double>& values) const;
+
+	// the value of the (minimization) objective for the given values
+	double getValue(const std::vector<double>& values) const;
+
+	// lower bound of the objective in the current node
+	double getBound() const;
+
+	// check whether the given bound can still improve over the incumbent
+	bool canImprove(double bound) const;
+
+	bool isTimeout();
+
+	unsigned int _numVariables;
+	std::vector<VariableType> _variableTypes;
+
+	// the objective, converted to minimization
+	std::vector<double> _objective;
+	double _constant;
+	bool _maximize;
+
+	// the constraints as rows lower <= sum coefs*vars <= upper, in compressed
+	// sparse row format
+	std::vector<unsigned int> _rowBegins;
+	std::vector<unsigned int> _rowVars;
+	std::vector<double>       _rowCoefs;
+	std::vector<double>       _rowLower;
+	std::vector<double>       _rowUpper;
+
+	// the rows of each variable, in compressed sparse column format
+	std::vector<unsigned int> _columnBegins;
+	std::vector<unsigned int> _columnRows;
+
+	// optional problem-specific lower bound
+	BoundFunction _boundFunction;
+
+	// rows that assign exactly one of their binary variables
+	std::vector<unsigned int> _choiceRows;
+
+	// the variables of the choice rows, in the order to try them
+	std::vector<std::vector<unsigned int>> _choiceOrders;
+
+	// current bounds of each variable and the changes since the root
+	std::vector<double> _lower;
+	std::vector<double> _upper;
+	std::vector<BoundChange> _trail;
+
+	// rows to propagate
+	std::vector<unsigned int> _queue;
+	std::vector<char> _queued;
+
+	// known solutions to start from
+	std::vector<std::vector<double>> _startSolutions;
+
+	// the best solution found so far
+	std::vector<double> _incumbent;
+	double _incumbentValue;
+
+	// the smallest lower bound of the branches that were not explored due to 
+	// a timeout, and the resulting global lower bound
+	double _openBound;
+	double _bestBound;
+
+	double _timeout;
+	double _gap;
+	bool _absoluteGap;
+	bool _verbose;
+
+	std::chrono::steady_clock::time_point _start;
+	size_t _numNodes;
+	bool _timedOut;
+};
+
+#endif // TED_EVALUATION_BRANCH_AND_BOUND_SOLVER_H__
+
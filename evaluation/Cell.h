@@ -1,7 +1,13 @@
 #ifndef TED_EVALUATION_CELL_H__
 #define TED_EVALUATION_CELL_H__
 
-#include <set>
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <iterator>
+#include "SmallSet.h"
+
+class Cells;
 
 /**
  * A cell is a set of connected locations build by intersecting a connected 
@@ -11,6 +17,11 @@
  * Cells are annotated with their original reconstruction label, as well as 
  * possible alternative reconstruction labels according to an external tolerance 
  * criterion.
+ *
+ * The locations of a cell are stored as runs of consecutive locations along 
+ * x. The runs are not owned by the cell, but stored in a contiguous range of 
+ * the buffer of the Cells it belongs to. Lazy cells only know their size and 
+ * one seed location, their runs are materialized by the Cells on first access.
  */
 template <typename LabelType>
 class Cell {
@@ -47,6 +58,93 @@ public:
 		}
 	};
 
+	/**
+	 * A run of consecutive locations [xBegin, xEnd) in row y of section z.
+	 */
+	struct Run {
+
+		Run(int z_, int y_, int xBegin_, int xEnd_) :
+			z(z_), y(y_), xBegin(xBegin_), xEnd(xEnd_) {}
+
+		// order runs in scan order, i.e., by section, row, and column
+		bool operator<(const Run& other) const {
+
+			if (z != other.z) return z < other.z;
+			if (y != other.y) return y < other.y;
+			return xBegin < other.xBegin;
+		}
+
+		int z, y, xBegin, xEnd;
+	};
+
+	/**
+	 * Iterator over the locations of a range of runs.
+	 */
+	class const_iterator {
+
+	public:
+
+		typedef std::forward_iterator_tag iterator_category;
+		typedef Location                  value_type;
+		typedef std::ptrdiff_t            difference_type;
+		typedef const Location*           pointer;
+		typedef Location                  reference;
+
+		const_iterator(const Run* run, const Run* end) :
+			_run(run),
+			_end(end),
+			_x(run != end ? run->xBegin : 0) {}
+
+		Location operator*() const { return Location(_x, _run->y, _run->z); }
+
+		const_iterator& operator++() {
+
+			if (++_x == _run->xEnd) {
+
+				++_run;
+				_x = (_run != _end ? _run->xBegin : 0);
+			}
+
+			return *this;
+		}
+
+		const_iterator operator++(int) { const_iterator i = *this; ++(*this); return i; }
+
+		bool operator==(const const_iterator& other) const { return _run == other._run && _x == other._x; }
+		bool operator!=(const const_iterator& other) const { return !(*this == other); }
+
+	private:
+
+		const Run* _run;
+		const Run* _end;
+		int        _x;
+	};
+
+	typedef const_iterator iterator;
+
+	/**
+	 * The runs of a cell, to be used in range-based for loops.
+	 */
+	struct Runs {
+
+		const Run* begin() const { return _begin; }
+		const Run* end() const { return _end; }
+		size_t size() const { return _end - _begin; }
+
+		const Run* _begin;
+		const Run* _end;
+	};
+
+	Cell() :
+		_label(0),
+		_groundTruthLabel(0),
+		_runs(0),
+		_numRuns(0),
+		_capacity(0),
+		_size(0),
+		_owner(0),
+		_seed(0, 0, 0) {}
+
 	/**
 	 * Set the original reconstruction label of this cell.
 	 */
@@ -88,55 +186,61 @@ public:
 	}
 
 	/**
-	 * Get the current list of alternative labels for this cell.
+	 * Remove all alternative labels of this cell.
 	 */
-	const std::set<LabelType>& getPossibleLabels() const {
+	void clearPossibleLabels() {
 
-		return _possibleLabels;
+		_possibleLabels.clear();
 	}
 
 	/**
-	 * Add a location to this cell.
+	 * Get the current list of alternative labels for this cell.
 	 */
-	void add(const Location& l) {
+	const SmallSet<LabelType>& getPossibleLabels() const {
 
-		_content.push_back(l);
+		return _possibleLabels;
 	}
 
 	/**
-	 * Add a boundary location to this cell.
+	 * Add a location to this cell. Extends the last run, if the location 
+	 * directly follows it, otherwise a new run is written to the range of the 
+	 * run buffer reserved for this cell.
 	 */
-	void addBoundary(const Location& l) {
+	void add(const Location& l) {
 
-		_boundary.push_back(l);
-	}
+		_size++;
 
-	/**
-	 * Remove a location from this cell. Returns false, if the location was not 
-	 * part of this cell.
-	 */
-	bool remove(const Location& l) {
+		if (_numRuns > 0) {
 
-		iterator i = _content.find(l);
+			Run& last = _runs[_numRuns - 1];
+			if (last.z == l.z && last.y == l.y && last.xEnd == l.x) {
 
-		if (i != _content.end())
-			_content.erase(i);
-		else
-			return false;
+				last.xEnd++;
+				return;
+			}
+		}
 
-		return true;
+		assert(_numRuns < _capacity);
+		_runs[_numRuns++] = Run(l.z, l.y, l.x, l.x + 1);
 	}
 
-	bool removeBoundary(const Location& l) {
+	/**
+	 * Add a run of locations to this cell.
+	 */
+	void add(const Run& run) {
 
-		iterator i = _boundary.find(l);
+		assert(_numRuns < _capacity);
+		_runs[_numRuns++] = run;
+		_size += run.xEnd - run.xBegin;
+	}
 
-		if (i != _boundary.end())
-			_boundary.erase(i);
-		else
-			return false;
+	/**
+	 * Sort the runs of this cell in scan order, for cells whose runs were 
+	 * not added in this order.
+	 */
+	void sortRuns() {
 
-		return true;
+		std::sort(_runs, _runs + _numRuns);
 	}
 
 	/**
@@ -144,27 +248,42 @@ public:
 	 */
 	unsigned int size() const {
 
-		return _content.size();
+		return _size;
+	}
+
+	/**
+	 * Get the runs of locations of this cell. For lazy cells, this 
+	 * materializes the runs.
+	 */
+	Runs getRuns() const;
+
+	/**
+	 * Check whether the locations of this cell are only materialized on 
+	 * demand.
+	 */
+	bool isLazy() const {
+
+		return _owner != 0;
 	}
 
-	const std::vector<Location>& getBoundary() const {
+	/**
+	 * Get the first location of this cell in scan order.
+	 */
+	Location getSeed() const {
 
-		return _boundary;
+		return (_numRuns > 0 ? Location(_runs[0].xBegin, _runs[0].y, _runs[0].z) : _seed);
 	}
 
 	/**
 	 * Iterator access to the locations of the cell.
 	 */
-	typedef typename std::vector<Location>::iterator       iterator;
-	typedef typename std::vector<Location>::const_iterator const_iterator;
-
-	iterator begin() { return _content.begin(); }
-	iterator end() { return _content.end(); }
-	const_iterator begin() const { return _content.begin(); }
-	const_iterator end() const { return _content.end(); }
+	const_iterator begin() const { Runs runs = getRuns(); return const_iterator(runs.begin(), runs.end()); }
+	const_iterator end() const { Runs runs = getRuns(); return const_iterator(runs.end(), runs.end()); }
 
 private:
 
+	friend class Cells;
+
 	// the original reconstruction label of this cell
 	LabelType _label;
 
@@ -172,13 +291,21 @@ private:
 	LabelType _groundTruthLabel;
 
 	// possible reconstruction labels, according to the tolerance criterion
-	std::set<LabelType> _possibleLabels;
+	SmallSet<LabelType> _possibleLabels;
+
+	// the runs of volume locations that constitute this cell, pointing into 
+	// the run buffer of Cells
+	Run*         _runs;
+	unsigned int _numRuns;
+	unsigned int _capacity;
 
-	// the volume locations that constitute this cell
-	std::vector<Location> _content;
+	// the number of locations
+	unsigned int _size;
 
-	// the locations that are forming the boundary
-	std::vector<Location> _boundary;
+	// for lazy cells, the Cells that materialize the runs, and the first 
+	// location to start the materialization from
+	const Cells* _owner;
+	Location     _seed;
 };
 
 #endif // TED_EVALUATION_CELL_H__
@@ -0,0 +1,229 @@
+#include <algorithm>
+#include <limits>
+#include <map>
+
+#include "CellSurface.h"
+
+CellSurface::CellSurface(
+		const Cells& cells,
+		const std::vector<unsigned int>& cellIndices) {
+
+	// the runs of all cells in the set, by row
+
+	typedef std::pair<int, int> Row;
+	typedef std::vector<std::pair<int, int>> RowRuns;
+
+	std::map<Row, RowRuns> rows;
+	for (unsigned int cellIndex : cellIndices)
+		for (const Cell<size_t>::Run& run : cells[cellIndex].getRuns())
+			rows[Row(run.z, run.y)].push_back(std::make_pair(run.xBegin, run.xEnd));
+
+	for (auto& row : rows)
+		std::sort(row.second.begin(), row.second.end());
+
+	auto getRow = [&](int z, int y) -> const RowRuns* {
+
+		auto row = rows.find(Row(z, y));
+		return (row == rows.end() ? 0 : &row->second);
+	};
+
+	auto contains = [](const RowRuns* row, int x) {
+
+		if (!row)
+			return false;
+
+		// the last run that starts at or before x
+		auto run = std::upper_bound(row->begin(), row->end(), std::make_pair(x, std::numeric_limits<int>::max()));
+		if (run == row->begin())
+			return false;
+
+		return x < (--run)->second;
+	};
+
+	for (unsigned int i = 0; i < cellIndices.size(); i++) {
+
+		unsigned int index = 0;
+
+		for (const Cell<size_t>::Run& run : cells[cellIndices[i]].getRuns()) {
+
+			const RowRuns* row   = getRow(run.z,     run.y);
+			const RowRuns* above = getRow(run.z,     run.y - 1);
+			const RowRuns* below = getRow(run.z,     run.y + 1);
+			const RowRuns* front = getRow(run.z - 1, run.y);
+			const RowRuns* back  = getRow(run.z + 1, run.y);
+
+			for (int x = run.xBegin; x < run.xEnd; x++, index++) {
+
+				bool isSurface =
+						!contains(row, x - 1) ||
+						!contains(row, x + 1) ||
+						!contains(above, x) ||
+						!contains(below, x) ||
+						!contains(front, x) ||
+						!contains(back, x);
+
+				if (!isSurface)
+					continue;
+
+				Point p;
+				p.x = x;
+				p.y = run.y;
+				p.z = run.z;
+				p.cell  = i;
+				p.index = index;
+
+				_points.push_back(p);
+			}
+		}
+	}
+
+	build(0, _points.size(), 0);
+}
+
+long long
+CellSurface::findClosestPair(
+		const CellSurface& other,
+		Cell<size_t>::Location& closest,
+		Cell<size_t>::Location& otherClosest) const {
+
+	// the smallest distance of each point to the other surface
+
+	long long best2 = std::numeric_limits<long long>::max();
+	std::vector<long long> nearest2(_points.size());
+
+	for (unsigned int i = 0; i < _points.size(); i++) {
+
+		long long d2 = best2;
+		other.findNearest(_points[i], 0, other._points.size(), 0, d2);
+
+		nearest2[i] = d2;
+		best2 = std::min(best2, d2);
+	}
+
+	// among all pairs with the smallest distance, take the last one in the 
+	// order of the cells and their locations
+
+	const Point* last      = 0;
+	const Point* otherLast = 0;
+
+	auto isLater = [&](const Point& a, const Point& b) {
+
+		if (!last)
+			return true;
+
+		if (a.cell != last->cell)
+			return a.cell > last->cell;
+		if (b.cell != otherLast->cell)
+			return b.cell > otherLast->cell;
+		if (a.index != last->index)
+			return a.index > last->index;
+		return b.index > otherLast->index;
+	};
+
+	std::vector<const Point*> found;
+	for (unsigned int i = 0; i < _points.size(); i++) {
+
+		if (nearest2[i] != best2)
+			continue;
+
+		found.clear();
+		other.findWithin(_points[i], best2, 0, other._points.size(), 0, found);
+
+		for (const Point* p : found)
+			if (isLater(_points[i], *p)) {
+
+				last      = &_points[i];
+				otherLast = p;
+			}
+	}
+
+	if (last) {
+
+		closest      = Cell<size_t>::Location(last->x, last->y, last->z);
+		otherClosest = Cell<size_t>::Location(otherLast->x, otherLast->y, otherLast->z);
+	}
+
+	return best2;
+}
+
+void
+CellSurface::build(size_t begin, size_t end, int depth) {
+
+	if (end - begin < 2)
+		return;
+
+	int    axis = depth%3;
+	size_t mid  = begin + (end - begin)/2;
+
+	std::nth_element(
+			_points.begin() + begin,
+			_points.begin() + mid,
+			_points.begin() + end,
+			[axis](const Point& a, const Point& b) { return coordinate(a, axis) < coordinate(b, axis); });
+
+	build(begin, mid, depth + 1);
+	build(mid + 1, end, depth + 1);
+}
+
+void
+CellSurface::findNearest(
+		const Point& p,
+		size_t begin,
+		size_t end,
+		int depth,
+		long long& best2) const {
+
+	if (begin >= end)
+		return;
+
+	int    axis = depth%3;
+	size_t mid  = begin + (end - begin)/2;
+
+	const Point& node = _points[mid];
+
+	best2 = std::min(best2, distance2(p, node));
+
+	long long d = coordinate(p, axis) - coordinate(node, axis);
+
+	// visit the side of p first, the other side only if it can be closer
+	if (d < 0) {
+
+		findNearest(p, begin, mid, depth + 1, best2);
+		if (d*d < best2)
+			findNearest(p, mid + 1, end, depth + 1, best2);
+
+	} else {
+
+		findNearest(p, mid + 1, end, depth + 1, best2);
+		if (d*d < best2)
+			findNearest(p, begin, mid, depth + 1, best2);
+	}
+}
+
+void
+CellSurface::findWithin(
+		const Point& p,
+		long long d2,
+		size_t begin,
+		size_t end,
+		int depth,
+		std::vector<const Point*>& found) const {
+
+	if (begin >= end)
+		return;
+
+	int    axis = depth%3;
+	size_t mid  = begin + (end - begin)/2;
+
+	const Point& node = _points[mid];
+
+	if (distance2(p, node) <= d2)
+		found.push_back(&node);
+
+	long long d = coordinate(p, axis) - coordinate(node, axis);
+
+	if (d <= 0 || d*d <= d2)
+		findWithin(p, d2, begin, mid, depth + 1, found);
+	if (d >= 0 || d*d <= d2)
+		findWithin(p, d2, mid + 1, end, depth + 1, found);
+}
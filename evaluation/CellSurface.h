@@ -0,0 +1,105 @@
+#ifndef TED_EVALUATION_CELL_SURFACE_H__
+#define TED_EVALUATION_CELL_SURFACE_H__
+
+#include <vector>
+
+#include "Cells.h"
+
+/**
+ * The surface of a set of cells, i.e., the locations of the cells with a 
+ * 6-neighbor outside of the set, in a k-d tree. The closest locations of two 
+ * disjoint sets of cells are always on their surfaces, since every other 
+ * location has a neighbor in the set that is closer to the other set.
+ */
+class CellSurface {
+
+public:
+
+	/**
+	 * Find the surface of the given cells.
+	 *
+	 * @param cells
+	 *             The list of all cells.
+	 * @param cellIndices
+	 *             The indices of the cells in the set.
+	 */
+	CellSurface(
+			const Cells& cells,
+			const std::vector<unsigned int>& cellIndices);
+
+	/**
+	 * Find the closest pair of locations between this and another set of 
+	 * cells. If there are several closest pairs, the result is the same as 
+	 * for a loop over all cells of this set, all cells of the other set, and 
+	 * all of their locations (in this order), that takes the last closest 
+	 * pair it sees.
+	 *
+	 * @return
+	 *             The squared distance between the closest locations.
+	 */
+	long long findClosestPair(
+			const CellSurface& other,
+			Cell<size_t>::Location& closest,
+			Cell<size_t>::Location& otherClosest) const;
+
+	/**
+	 * Get the number of surface locations.
+	 */
+	size_t size() const { return _points.size(); }
+
+private:
+
+	friend class SurfaceSpanningTree;
+
+	struct Point {
+
+		int x, y, z;
+
+		// the position of the cell in the set, and of the location in the 
+		// cell, to order closest pairs
+		unsigned int cell;
+		unsigned int index;
+	};
+
+	static long long distance2(const Point& a, const Point& b) {
+
+		long long dx = a.x - b.x;
+		long long dy = a.y - b.y;
+		long long dz = a.z - b.z;
+
+		return dx*dx + dy*dy + dz*dz;
+	}
+
+	static int coordinate(const Point& p, int axis) {
+
+		return (axis == 0 ? p.x : (axis == 1 ? p.y : p.z));
+	}
+
+	// sort the points in [begin, end) into a k-d tree, the median of each 
+	// range is the node that splits it along the axis of its depth
+	void build(size_t begin, size_t end, int depth);
+
+	// lower best2 to the smallest squared distance of a point in [begin, end) 
+	// to p
+	void findNearest(
+			const Point& p,
+			size_t begin,
+			size_t end,
+			int depth,
+			long long& best2) const;
+
+	// collect the points in [begin, end) that are not further than the 
+	// squared distance d2 from p
+	void findWithin(
+			const Point& p,
+			long long d2,
+			size_t begin,
+			size_t end,
+			int depth,
+			std::vector<const Point*>& found) const;
+
+	std::vector<Point> _points;
+};
+
+#endif // TED_EVALUATION_CELL_SURFACE_H__
+
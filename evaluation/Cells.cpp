@@ -0,0 +1,132 @@
+#include <algorithm>
+#include <deque>
+
+#include <util/Logger.h>
+#include "Cells.h"
+
+logger::LogChannel cellslog("cellslog", "[Cells] ");
+
+Cell<size_t>::Runs
+Cells::getLazyRuns(const Cell<size_t>& cell) const {
+
+	{
+		std::lock_guard<std::mutex> lock(_materializedRunsMutex);
+
+		auto i = _materializedRuns.find(&cell);
+		if (i != _materializedRuns.end()) {
+
+			Cell<size_t>::Runs runs = { i->second.data(), i->second.data() + i->second.size() };
+			return runs;
+		}
+	}
+
+	// materialize without holding the lock, such that several cells can be 
+	// materialized concurrently
+	std::vector<Cell<size_t>::Run> materialized = floodFill(_gtLabels, _recLabels, cell._seed);
+
+	LOG_ALL(cellslog) << "materialized lazy cell with " << materialized.size() << " runs" << std::endl;
+
+	std::lock_guard<std::mutex> lock(_materializedRunsMutex);
+
+	// if another thread was faster, the runs of the other thread are used
+	const std::vector<Cell<size_t>::Run>& runs =
+			_materializedRuns.insert(std::make_pair(&cell, std::move(materialized))).first->second;
+
+	Cell<size_t>::Runs result = { runs.data(), runs.data() + runs.size() };
+	return result;
+}
+
+std::vector<Cell<size_t>::Run>
+Cells::floodFill(
+		const ImageStack& gtLabels,
+		const ImageStack& recLabels,
+		const Cell<size_t>::Location& seed) {
+
+	int depth  = gtLabels.size();
+	int width  = gtLabels.width();
+	int height = gtLabels.height();
+
+	size_t gtLabel  = (*gtLabels[seed.z])(seed.x, seed.y);
+	size_t recLabel = (*recLabels[seed.z])(seed.x, seed.y);
+
+	auto matches = [&](int x, int y, int z) {
+
+		return
+				(size_t)(*gtLabels[z])(x, y)  == gtLabel &&
+				(size_t)(*recLabels[z])(x, y) == recLabel;
+	};
+
+	// the runs found so far, by row
+	std::map<std::pair<int, int>, std::vector<Cell<size_t>::Run>> rows;
+
+	auto isVisited = [&](int x, int y, int z) {
+
+		auto row = rows.find(std::make_pair(z, y));
+		if (row == rows.end())
+			return false;
+
+		for (const Cell<size_t>::Run& run : row->second)
+			if (x >= run.xBegin && x < run.xEnd)
+				return true;
+
+		return false;
+	};
+
+	std::deque<Cell<size_t>::Run> queue;
+
+	// grow a run from location (x, y, z) in both directions
+	auto addRun = [&](int x, int y, int z) {
+
+		int xBegin = x;
+		int xEnd   = x + 1;
+
+		while (xBegin > 0 && matches(xBegin - 1, y, z))
+			xBegin--;
+		while (xEnd < width && matches(xEnd, y, z))
+			xEnd++;
+
+		Cell<size_t>::Run run(z, y, xBegin, xEnd);
+
+		rows[std::make_pair(z, y)].push_back(run);
+		queue.push_back(run);
+
+		return xEnd;
+	};
+
+	addRun(seed.x, seed.y, seed.z);
+
+	while (!queue.empty()) {
+
+		Cell<size_t>::Run run = queue.front();
+		queue.pop_front();
+
+		// visit the rows in the indirect neighborhood, runs are connected if 
+		// they overlap after growing by one in x
+		for (int z = std::max(0, run.z - 1); z <= std::min(depth - 1, run.z + 1); z++)
+			for (int y = std::max(0, run.y - 1); y <= std::min(height - 1, run.y + 1); y++) {
+
+				if (z == run.z && y == run.y)
+					continue;
+
+				int x = std::max(0, run.xBegin - 1);
+				while (x < std::min(width, run.xEnd + 1)) {
+
+					if (matches(x, y, z) && !isVisited(x, y, z))
+						x = addRun(x, y, z);
+					else
+						x++;
+				}
+			}
+	}
+
+	std::vector<Cell<size_t>::Run> runs;
+	for (const auto& row : rows)
+		for (const Cell<size_t>::Run& run : row.second)
+			runs.push_back(run);
+
+	// runs of a row are found in arbitrary order
+	std::sort(runs.begin(), runs.end());
+
+	return runs;
+}
+
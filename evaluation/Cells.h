@@ -1,10 +1,142 @@
 #ifndef TED_EVALUATION_CELLS_H__
 #define TED_EVALUATION_CELLS_H__
 
+#include <limits>
 #include <vector>
+#include <map>
+#include <mutex>
+
+#include <imageprocessing/ImageStack.h>
 #include "Cell.h"
 
-typedef std::vector<Cell<size_t>> Cells;
+/**
+ * A list of cells, that stores the location runs of all cells in one 
+ * contiguous buffer. Each cell owns a consecutive range of the buffer, such 
+ * that the number of runs of each cell has to be known when the cells are 
+ * created.
+ *
+ * Cells can also be lazy, in which case only their size and seed location are 
+ * known. Their runs are found with a flood fill in the label images on first 
+ * access, and kept until the Cells are destructed.
+ */
+class Cells {
+
+public:
+
+	typedef std::vector<Cell<size_t>>::iterator       iterator;
+	typedef std::vector<Cell<size_t>>::const_iterator const_iterator;
+
+	/**
+	 * Index used for cells without a previous cell, see 
+	 * LocalToleranceFunction::updateCells().
+	 */
+	enum : unsigned int { NoCell = std::numeric_limits<unsigned int>::max() };
+
+	/**
+	 * Create empty cells with space for the given number of runs each.
+	 */
+	Cells(const std::vector<size_t>& numRuns) :
+		_cells(numRuns.size()) {
+
+		size_t totalRuns = 0;
+		for (size_t n : numRuns)
+			totalRuns += n;
+
+		_runs.resize(totalRuns, Cell<size_t>::Run(0, 0, 0, 0));
+
+		Cell<size_t>::Run* runs = _runs.data();
+		for (size_t i = 0; i < _cells.size(); i++) {
+
+			_cells[i]._runs     = runs;
+			_cells[i]._capacity = numRuns[i];
+			runs += numRuns[i];
+		}
+	}
+
+	// cells point into the run buffer, don't copy
+	Cells(const Cells& other) = delete;
+	Cells& operator=(const Cells& other) = delete;
+
+	/**
+	 * Set the ground truth and reconstruction label images the cells were 
+	 * extracted from. Needed to materialize lazy cells.
+	 */
+	void setLabelImages(const ImageStack& gtLabels, const ImageStack& recLabels) {
+
+		_gtLabels  = gtLabels;
+		_recLabels = recLabels;
+	}
+
+	/**
+	 * Make the i-th cell lazy. Its locations will be materialized on demand, 
+	 * by a flood fill starting from the given seed location.
+	 *
+	 * @param seed
+	 *             The first location of the cell in scan order.
+	 * @param size
+	 *             The number of locations of the cell.
+	 */
+	void setLazy(size_t i, const Cell<size_t>::Location& seed, unsigned int size) {
+
+		_cells[i]._owner = this;
+		_cells[i]._seed  = seed;
+		_cells[i]._size  = size;
+	}
+
+	/**
+	 * Get the number of cells.
+	 */
+	size_t size() const { return _cells.size(); }
+
+	Cell<size_t>& operator[](size_t i) { return _cells[i]; }
+	const Cell<size_t>& operator[](size_t i) const { return _cells[i]; }
+
+	iterator begin() { return _cells.begin(); }
+	iterator end() { return _cells.end(); }
+	const_iterator begin() const { return _cells.begin(); }
+	const_iterator end() const { return _cells.end(); }
+
+	/**
+	 * Find the runs of the connected component of locations with the same 
+	 * ground truth and reconstruction label as the seed location, in scan 
+	 * order.
+	 */
+	static std::vector<Cell<size_t>::Run> floodFill(
+			const ImageStack& gtLabels,
+			const ImageStack& recLabels,
+			const Cell<size_t>::Location& seed);
+
+private:
+
+	friend class Cell<size_t>;
+
+	// get the runs of a lazy cell, materialize them if needed
+	Cell<size_t>::Runs getLazyRuns(const Cell<size_t>& cell) const;
+
+	std::vector<Cell<size_t>> _cells;
+
+	// the runs of all cells, cell by cell
+	std::vector<Cell<size_t>::Run> _runs;
+
+	// the label images to materialize lazy cells from
+	ImageStack _gtLabels;
+	ImageStack _recLabels;
+
+	// the runs of lazy cells that have been materialized so far
+	mutable std::map<const Cell<size_t>*, std::vector<Cell<size_t>::Run>> _materializedRuns;
+	mutable std::mutex _materializedRunsMutex;
+};
+
+template <typename LabelType>
+typename Cell<LabelType>::Runs
+Cell<LabelType>::getRuns() const {
+
+	if (_owner)
+		return _owner->getLazyRuns(*this);
+
+	Runs runs = { _runs, _runs + _numRuns };
+	return runs;
+}
 
 #endif // TED_EVALUATION_CELLS_H__
 
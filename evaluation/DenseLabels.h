@@ -0,0 +1,131 @@
+#ifndef TED_EVALUATION_DENSE_LABELS_H__
+#define TED_EVALUATION_DENSE_LABELS_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+/**
+ * Compaction of sparse labels to dense ids 0,...,n-1, to be used as indices 
+ * into arrays instead of maps over labels. Ids are assigned in the order in 
+ * which labels are inserted, such that inserting labels in increasing order 
+ * gives ids in increasing label order.
+ *
+ * Lookups use an open addressing hash table with linear probing.
+ */
+class DenseLabels {
+
+public:
+
+	// the id returned for labels that were not inserted
+	enum : unsigned int { NoId = std::numeric_limits<unsigned int>::max() };
+
+	DenseLabels() :
+		_table(16, NoId) {}
+
+	/**
+	 * Get the id of the given label. Assigns the next free id, if the label 
+	 * was not seen before.
+	 */
+	unsigned int insert(size_t label) {
+
+		size_t slot = findSlot(label);
+
+		if (_table[slot] != NoId)
+			return _table[slot];
+
+		unsigned int id = _labels.size();
+		_labels.push_back(label);
+		_table[slot] = id;
+
+		// keep the load factor below 1/2
+		if (2*_labels.size() > _table.size())
+			grow();
+
+		return id;
+	}
+
+	/**
+	 * Get the id of the given label, or NoId if the label was not inserted.
+	 */
+	unsigned int find(size_t label) const {
+
+		return _table[findSlot(label)];
+	}
+
+	/**
+	 * Check whether the given label was inserted.
+	 */
+	bool contains(size_t label) const {
+
+		return find(label) != NoId;
+	}
+
+	/**
+	 * Get the label of the given id.
+	 */
+	size_t getLabel(unsigned int id) const {
+
+		return _labels[id];
+	}
+
+	/**
+	 * Get all labels, indexed by their id.
+	 */
+	const std::vector<size_t>& getLabels() const {
+
+		return _labels;
+	}
+
+	/**
+	 * The number of labels.
+	 */
+	size_t size() const {
+
+		return _labels.size();
+	}
+
+	void clear() {
+
+		_labels.clear();
+		_table.assign(16, NoId);
+	}
+
+private:
+
+	size_t findSlot(size_t label) const {
+
+		size_t mask = _table.size() - 1;
+		size_t slot = hash(label) & mask;
+
+		while (_table[slot] != NoId && _labels[_table[slot]] != label)
+			slot = (slot + 1) & mask;
+
+		return slot;
+	}
+
+	void grow() {
+
+		_table.assign(2*_table.size(), NoId);
+
+		for (unsigned int id = 0; id < _labels.size(); id++)
+			_table[findSlot(_labels[id])] = id;
+	}
+
+	static size_t hash(size_t label) {
+
+		// Fibonacci hashing, spreads consecutive labels over the table
+		uint64_t h = static_cast<uint64_t>(label)*UINT64_C(0x9E3779B97F4A7C15);
+		return static_cast<size_t>(h ^ (h >> 32));
+	}
+
+	// the label of each id
+	std::vector<size_t> _labels;
+
+	// ids by hash slot, the size is a power of two
+	std::vector<unsigned int> _table;
+};
+
+#endif // TED_EVALUATION_DENSE_LABELS_H__
+
@@ -1,10 +1,9 @@
-#include <inference/LinearConstraints.h>
 #include <inference/LinearObjective.h>
 #include <inference/LinearSolverBackend.h>
-#include <inference/SolverFactory.h>
 #include <inference/Solution.h>
 #include <util/Logger.h>
 #include "DetectionOverlap.h"
+#include "SparseConstraints.h"
 
 logger::LogChannel detectionoverlaplog("detectionoverlaplog", "[DetectionOverlap] ");
 
@@ -97,35 +96,28 @@ DetectionOverlap::compute(const ImageStack& groundTruth, const ImageStack& recon
 	//     sum of pair indicators ≤ 1
 	// (analogously for other direction)
 
-	LinearConstraints constraints;
+	// every pair appears once in the rows of its rec and its gt label
+	SparseConstraints constraints;
+	constraints.reserve(recLabels.size() + gtLabels.size(), 2*overlapPairs.size());
+
 	for (size_t recLabel : recLabels) {
 
-		LinearConstraint constraint;
+		constraints.addRow(LessEqual, 1.0);
 		for (size_t gtLabel : recToGtOverlaps[recLabel]) {
 
 			unsigned int varNum = pairToVariable[std::make_pair(gtLabel, recLabel)];
-			constraint.setCoefficient(varNum, 1.0);
+			constraints.addCoefficient(varNum, 1.0);
 		}
-
-		constraint.setRelation(LessEqual);
-		constraint.setValue(1.0);
-
-		constraints.add(constraint);
 	}
 
 	for (size_t gtLabel : gtLabels) {
 
-		LinearConstraint constraint;
+		constraints.addRow(LessEqual, 1.0);
 		for (size_t recLabel : gtToRecOverlaps[gtLabel]) {
 
 			unsigned int varNum = pairToVariable[std::make_pair(gtLabel, recLabel)];
-			constraint.setCoefficient(varNum, 1.0);
+			constraints.addCoefficient(varNum, 1.0);
 		}
-
-		constraint.setRelation(LessEqual);
-		constraint.setValue(1.0);
-
-		constraints.add(constraint);
 	}
 
 	// build objective
@@ -140,18 +132,15 @@ DetectionOverlap::compute(const ImageStack& groundTruth, const ImageStack& recon
 
 	// solve
 
-	SolverFactory factory;
-	// TODO: use std::unique_ptr
-	LinearSolverBackend* solver = factory.createLinearSolverBackend();
+	std::unique_ptr<LinearSolverBackend> solver = createSolverBackend(_solverBackend);
 	solver->initialize(overlapPairs.size(), Binary);
 
 	solver->setObjective(objective);
-	solver->setConstraints(constraints);
+	setConstraints(*solver, constraints);
 
 	std::string msg;
 	Solution solution;
 	solver->solve(solution, msg);
-	delete solver;
 
 	// get the optimal matching
 
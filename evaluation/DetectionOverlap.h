@@ -4,6 +4,7 @@
 #include <util/point.hpp>
 #include <imageprocessing/ImageStack.h>
 #include "DetectionOverlapErrors.h"
+#include "SolverBackend.h"
 
 /**
  * An error measure that counts the number of TP, FP, and FN regions, based on 
@@ -20,6 +21,13 @@ class DetectionOverlap {
 
 public:
 
+	/**
+	 * @param solverBackend
+	 *             The linear solver backend to find the best matching with.
+	 */
+	DetectionOverlap(SolverBackend solverBackend = ExternalSolver) :
+		_solverBackend(solverBackend) {}
+
 	DetectionOverlapErrors compute(const ImageStack& groundTruth, const ImageStack& reconstruction);
 
 private:
@@ -37,6 +45,8 @@ private:
 			std::map<std::pair<size_t, size_t>, unsigned int>& overlapAreas,
 			std::map<size_t, std::set<size_t> >& atob,
 			std::map<size_t, std::set<size_t> >& btoa);
+
+	SolverBackend _solverBackend;
 };
 
 #endif // TED_DETECTION_OVERLAP_H__
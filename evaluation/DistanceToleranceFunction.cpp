@@ -1,6 +1,7 @@
 #include "DistanceToleranceFunction.h"
 #include <util/Logger.h>
 #include <vigra/multi_distance.hxx>
+#include "Parallel.h"
 //#include <vigra/multi_impex.hxx>
 
 logger::LogChannel distancetolerancelog("distancetolerancelog", "[DistanceToleranceFunction] ");
@@ -8,10 +9,12 @@ logger::LogChannel distancetolerancelog("distancetolerancelog", "[DistanceTolera
 DistanceToleranceFunction::DistanceToleranceFunction(
 		float distanceThreshold,
 		bool allowBackgroundAppearance,
-		size_t recBackgroundLabel) :
+		size_t recBackgroundLabel,
+		AlternativeLabelSearch alternativeLabelSearch) :
 	_allowBackgroundAppearance(allowBackgroundAppearance),
 	_recBackgroundLabel(recBackgroundLabel),
-	_maxDistanceThreshold(distanceThreshold) {}
+	_maxDistanceThreshold(distanceThreshold),
+	_alternativeLabelSearch(alternativeLabelSearch) {}
 
 void
 DistanceToleranceFunction::findPossibleCellLabels(
@@ -21,76 +24,74 @@ DistanceToleranceFunction::findPossibleCellLabels(
 
 	initializeCellLabels(cells);
 
-	_depth  = gtLabels.size();
-	_width  = gtLabels.width();
-	_height = gtLabels.height();
-	_resolutionX = gtLabels.getResolutionX();
-	_resolutionY = gtLabels.getResolutionY();
-	_resolutionZ = gtLabels.getResolutionZ();
-
-	createBoundaryMap(recLabels);
-
 	// limit analysis to promising relabel candidates
 	std::vector<size_t> relabelCandidates = findRelabelCandidates(cells, recLabels, gtLabels);
 
-	_maxDistanceThresholdX = std::min(_width,  (unsigned int)round(_maxDistanceThreshold/_resolutionX));
-	_maxDistanceThresholdY = std::min(_height, (unsigned int)round(_maxDistanceThreshold/_resolutionY));
-	_maxDistanceThresholdZ = std::min(_depth,  (unsigned int)round(_maxDistanceThreshold/_resolutionZ));
-
-	LOG_DEBUG(distancetolerancelog)
-			<< "distance thresholds in pixels (x, y, z) are ("
-			<< _maxDistanceThresholdX << ", "
-			<< _maxDistanceThresholdY << ", "
-			<< _maxDistanceThresholdZ << ")" << std::endl;
-
 	LOG_DEBUG(distancetolerancelog) << "there are " << relabelCandidates.size() << " cells that can be relabeled" << std::endl;
 
 	if (relabelCandidates.size() == 0)
 		return;
 
-	LOG_DEBUG(distancetolerancelog) << "creating distance threshold neighborhood" << std::endl;
+	// the alternative labels for each relabel candidate
+	std::vector<std::set<size_t>> alternativeLabels;
 
-	// list of all location offsets within threshold distance
-	std::vector<Cell<size_t>::Location> neighborhood = createNeighborhood();
+	if (_alternativeLabelSearch == DistanceTransform) {
 
-	LOG_DEBUG(distancetolerancelog) << "there are " << neighborhood.size() << " pixels in the neighborhood for a threshold of " << _maxDistanceThreshold << std::endl;
+		alternativeLabels = getAlternativeLabelsByDistanceTransform(*cells, relabelCandidates, recLabels);
 
-	// for each cell
-	int i = 0;
-	for (unsigned int index : relabelCandidates) {
+	} else {
 
-		i++;
-		LOG_DEBUG(distancetolerancelog)
-				<< logger::delline << "processing cell "
-				<< i << "/" << relabelCandidates.size()
-				<< std::flush;
+		LOG_DEBUG(distancetolerancelog) << "creating distance threshold neighborhood" << std::endl;
+
+		// list of all location offsets within threshold distance
+		std::vector<Cell<size_t>::Location> neighborhood = createNeighborhood();
+
+		LOG_DEBUG(distancetolerancelog) << "there are " << neighborhood.size() << " pixels in the neighborhood for a threshold of " << _maxDistanceThreshold << std::endl;
 
-		Cell<size_t>& cell = (*cells)[index];
+		alternativeLabels.resize(relabelCandidates.size());
 
-		LOG_ALL(distancetolerancelog)
-				<< "processing cell " << index
-				<< " (rec label " << cell.getReconstructionLabel() << ")"
-				<< " (gt label " << cell.getGroundTruthLabel() << ")"
+		// Cell sizes vary by orders of magnitude. Process the largest cells 
+		// first, such that the threads stay busy with the small ones at the 
+		// end.
+		std::vector<unsigned int> order = getProcessingOrder(*cells, relabelCandidates);
+
+		LOG_DEBUG(distancetolerancelog)
+				<< "searching alternative labels for " << relabelCandidates.size()
+				<< " cells with " << getNumWorkerThreads(_numThreads) << " threads"
 				<< std::endl;
 
-		std::set<size_t> alternativeLabels = getAlternativeLabels(cell, neighborhood, recLabels);
+		parallelFor(
+				order.size(),
+				_numThreads,
+				[&](size_t j) {
+
+					unsigned int i = order[j];
+
+					alternativeLabels[i] = getAlternativeLabels(
+							(*cells)[relabelCandidates[i]],
+							neighborhood,
+							recLabels);
+				});
+	}
+
+	for (unsigned int i = 0; i < relabelCandidates.size(); i++) {
+
+		Cell<size_t>& cell = (*cells)[relabelCandidates[i]];
 
-		// if there are alternatives, include the background label as well (since a 
-		// background label can be created between two foreground labels -- 
-		// sufficient condition is that the cell is covered by another cell of 
-		// different label, which is the case when there is at least one 
-		// alternative)
+		// if there are alternatives, include the background label as well 
+		// (since a background label can be created between two foreground 
+		// labels -- sufficient condition is that the cell is covered by 
+		// another cell of different label, which is the case when there is at 
+		// least one alternative)
 		if (_allowBackgroundAppearance)
-			if (alternativeLabels.size() > 0 && cell.getReconstructionLabel() != _recBackgroundLabel)
-				alternativeLabels.insert(_recBackgroundLabel);
+			if (alternativeLabels[i].size() > 0 && cell.getReconstructionLabel() != _recBackgroundLabel)
+				alternativeLabels[i].insert(_recBackgroundLabel);
 
 		// for each alternative label
-		for (size_t recLabel : alternativeLabels)
+		for (size_t recLabel : alternativeLabels[i])
 			cell.addPossibleLabel(recLabel);
 	}
 
-	LOG_DEBUG(distancetolerancelog) << std::endl;
-
 	//for (const Cell<size_t>& cell : *_cells) {
 
 		//LOG_ALL(distancetolerancelog) << "cell with GT label " << cell.getGroundTruthLabel() << " can map to: ";
@@ -101,19 +102,142 @@ DistanceToleranceFunction::findPossibleCellLabels(
 	//}
 }
 
+std::vector<std::vector<float>>
+DistanceToleranceFunction::getPossibleLabelDistances(
+		const Cells& cells,
+		const ImageStack& recLabels) {
+
+	float maxDistance2 = _maxDistanceThreshold*_maxDistanceThreshold;
+
+	std::vector<std::vector<float>> distances(cells.size());
+
+	// the cells with alternatives, by alternative label
+	std::map<size_t, std::vector<unsigned int>> cellsByLabel;
+	std::vector<unsigned int> ambiguousCells;
+
+	for (unsigned int cellIndex = 0; cellIndex < cells.size(); cellIndex++) {
+
+		const Cell<size_t>& cell = cells[cellIndex];
+
+		distances[cellIndex].assign(cell.getPossibleLabels().size(), 0);
+
+		if (cell.getPossibleLabels().size() < 2)
+			continue;
+
+		ambiguousCells.push_back(cellIndex);
+		for (size_t l : cell.getPossibleLabels())
+			if (l != cell.getReconstructionLabel())
+				cellsByLabel[l].push_back(cellIndex);
+	}
+
+	LOG_DEBUG(distancetolerancelog)
+			<< "computing label distances for " << ambiguousCells.size()
+			<< " cells with alternative labels" << std::endl;
+
+	std::vector<vigra::Shape3> boxBegin(cells.size());
+	std::vector<vigra::Shape3> boxEnd(cells.size());
+
+	parallelFor(
+			ambiguousCells.size(),
+			_numThreads,
+			[&](size_t i) {
+
+				unsigned int cellIndex = ambiguousCells[i];
+				getBoundingBox(cells[cellIndex], boxBegin[cellIndex], boxEnd[cellIndex]);
+			});
+
+	std::vector<size_t> labels;
+	for (const auto& p : cellsByLabel)
+		labels.push_back(p.first);
+
+	// the position of a label in the possible labels of a cell
+	auto position = [&](unsigned int cellIndex, size_t label) {
+
+		const SmallSet<size_t>& possibleLabels = cells[cellIndex].getPossibleLabels();
+		return std::lower_bound(possibleLabels.begin(), possibleLabels.end(), label) - possibleLabels.begin();
+	};
+
+	// one distance transform per label, as in 
+	// getAlternativeLabelsByDistanceTransform(), but keeping the distances
+	parallelFor(
+			labels.size(),
+			_numThreads,
+			[&](size_t j) {
+
+				const std::vector<unsigned int>& labelCells = cellsByLabel.at(labels[j]);
+
+				vigra::Shape3 begin(_width, _height, _depth);
+				vigra::Shape3 end(0, 0, 0);
+				std::vector<const Cell<size_t>*> candidateCells;
+				for (unsigned int cellIndex : labelCells) {
+
+					for (int d = 0; d < 3; d++) {
+
+						begin[d] = std::min(begin[d], boxBegin[cellIndex][d]);
+						end[d]   = std::max(end[d],   boxEnd[cellIndex][d]);
+					}
+					candidateCells.push_back(&cells[cellIndex]);
+				}
+
+				std::vector<float> covering = getCoveringDistances(labels[j], candidateCells, begin, end, recLabels);
+
+				// every possible label is possible for the current threshold, 
+				// even if the two label searches disagree in the last bit, or 
+				// the label is only possible as appearing background (see 
+				// below)
+				for (unsigned int k = 0; k < labelCells.size(); k++)
+					distances[labelCells[k]][position(labelCells[k], labels[j])] = std::min(covering[k], maxDistance2);
+			});
+
+	// background can appear as soon as there is any other alternative
+	if (_allowBackgroundAppearance)
+		for (unsigned int cellIndex : ambiguousCells) {
+
+			const Cell<size_t>& cell = cells[cellIndex];
+
+			if (cell.getReconstructionLabel() == _recBackgroundLabel || cell.getPossibleLabels().count(_recBackgroundLabel) == 0)
+				continue;
+
+			float& background = distances[cellIndex][position(cellIndex, _recBackgroundLabel)];
+			for (float distance : distances[cellIndex])
+				if (distance > 0)
+					background = std::min(background, distance);
+		}
+
+	return distances;
+}
+
 void
-DistanceToleranceFunction::initializeCellLabels(std::shared_ptr<Cells> cells) {
+DistanceToleranceFunction::initialize(
+		const ImageStack& gtLabels,
+		const ImageStack& recLabels) {
 
-	// every cell can at least keep it's original label
-	for (auto& cell : *cells)
-		cell.addPossibleLabel(cell.getReconstructionLabel());
+	_depth  = gtLabels.size();
+	_width  = gtLabels.width();
+	_height = gtLabels.height();
+	_resolutionX = gtLabels.getResolutionX();
+	_resolutionY = gtLabels.getResolutionY();
+	_resolutionZ = gtLabels.getResolutionZ();
+
+	createBoundaryMap(recLabels);
+
+	_maxDistanceThresholdX = std::min(_width,  (unsigned int)round(_maxDistanceThreshold/_resolutionX));
+	_maxDistanceThresholdY = std::min(_height, (unsigned int)round(_maxDistanceThreshold/_resolutionY));
+	_maxDistanceThresholdZ = std::min(_depth,  (unsigned int)round(_maxDistanceThreshold/_resolutionZ));
+
+	LOG_DEBUG(distancetolerancelog)
+			<< "distance thresholds in pixels (x, y, z) are ("
+			<< _maxDistanceThresholdX << ", "
+			<< _maxDistanceThresholdY << ", "
+			<< _maxDistanceThresholdZ << ")" << std::endl;
 }
 
-std::vector<size_t>
-DistanceToleranceFunction::findRelabelCandidates(
-		std::shared_ptr<Cells> cells,
-		const ImageStack& recLabels,
-		const ImageStack& gtLabels) {
+void
+DistanceToleranceFunction::findNonCandidateLocations(
+		const ImageStack& gtLabels,
+		const ImageStack& recLabels) {
+
+	initialize(gtLabels, recLabels);
 
 	vigra::Shape3 shape(_width, _height, _depth);
 	vigra::MultiArray<3, float> boundaryDistance2(shape);
@@ -131,22 +255,137 @@ DistanceToleranceFunction::findRelabelCandidates(
 			true /* background */,
 			pitch);
 
-	size_t numCells = cells->size();
+	// cells with a location further away from a boundary than the threshold 
+	// can not be relabeled
+	_nonCandidateLocations.reshape(shape);
+	for (unsigned int z = 0; z < _depth; z++)
+		for (unsigned int y = 0; y < _height; y++)
+			for (unsigned int x = 0; x < _width; x++)
+				_nonCandidateLocations(x, y, z) =
+						(boundaryDistance2(x, y, z) > _maxDistanceThreshold*_maxDistanceThreshold);
+}
+
+void
+DistanceToleranceFunction::updateNonCandidateLocations(
+		const ImageStack& /*gtLabels*/,
+		const ImageStack& recLabels,
+		const vigra::Shape3& changedBegin,
+		const vigra::Shape3& changedEnd) {
+
+	updateBoundaryMap(recLabels, changedBegin, changedEnd);
+
+	// Boundaries changed only in the changed box grown by one location. Only 
+	// locations within the threshold distance of those can change between 
+	// candidate and non-candidate location.
+	vigra::Shape3 begin, end;
+	begin[0] = std::max((std::ptrdiff_t)0, changedBegin[0] - _maxDistanceThresholdX - 1);
+	begin[1] = std::max((std::ptrdiff_t)0, changedBegin[1] - _maxDistanceThresholdY - 1);
+	begin[2] = std::max((std::ptrdiff_t)0, changedBegin[2] - _maxDistanceThresholdZ - 1);
+	end[0]   = std::min((std::ptrdiff_t)_width,  changedEnd[0] + _maxDistanceThresholdX + 1);
+	end[1]   = std::min((std::ptrdiff_t)_height, changedEnd[1] + _maxDistanceThresholdY + 1);
+	end[2]   = std::min((std::ptrdiff_t)_depth,  changedEnd[2] + _maxDistanceThresholdZ + 1);
+
+	// The closest boundary of those locations is within the threshold 
+	// distance again, if it is close enough at all. Compute the distances in 
+	// a box grown by the threshold.
+	vigra::Shape3 cropBegin, cropEnd;
+	cropBegin[0] = std::max((std::ptrdiff_t)0, begin[0] - _maxDistanceThresholdX);
+	cropBegin[1] = std::max((std::ptrdiff_t)0, begin[1] - _maxDistanceThresholdY);
+	cropBegin[2] = std::max((std::ptrdiff_t)0, begin[2] - _maxDistanceThresholdZ);
+	cropEnd[0]   = std::min((std::ptrdiff_t)_width,  end[0] + _maxDistanceThresholdX);
+	cropEnd[1]   = std::min((std::ptrdiff_t)_height, end[1] + _maxDistanceThresholdY);
+	cropEnd[2]   = std::min((std::ptrdiff_t)_depth,  end[2] + _maxDistanceThresholdZ);
+
+	vigra::Shape3 shape(
+			cropEnd[0] - cropBegin[0],
+			cropEnd[1] - cropBegin[1],
+			cropEnd[2] - cropBegin[2]);
+
+	vigra::MultiArray<3, bool>  boundaryMap(shape);
+	vigra::MultiArray<3, float> boundaryDistance2(shape);
+
+	bool haveBoundary = false;
+	for (int z = 0; z < shape[2]; z++)
+		for (int y = 0; y < shape[1]; y++)
+			for (int x = 0; x < shape[0]; x++) {
+
+				boundaryMap(x, y, z) = _boundaryMap(x + cropBegin[0], y + cropBegin[1], z + cropBegin[2]);
+				haveBoundary |= boundaryMap(x, y, z);
+			}
+
+	float pitch[3];
+	pitch[0] = _resolutionX;
+	pitch[1] = _resolutionY;
+	pitch[2] = _resolutionZ;
+
+	if (haveBoundary)
+		vigra::separableMultiDistSquared(
+				boundaryMap,
+				boundaryDistance2,
+				true /* background */,
+				pitch);
+
+	for (int z = begin[2]; z < end[2]; z++)
+		for (int y = begin[1]; y < end[1]; y++)
+			for (int x = begin[0]; x < end[0]; x++)
+				_nonCandidateLocations(x, y, z) =
+						(!haveBoundary ||
+						 boundaryDistance2(x - cropBegin[0], y - cropBegin[1], z - cropBegin[2]) > _maxDistanceThreshold*_maxDistanceThreshold);
+}
+
+void
+DistanceToleranceFunction::growChangedBox(vigra::Shape3& begin, vigra::Shape3& end) {
+
+	begin[0] -= _maxDistanceThresholdX + 1;
+	begin[1] -= _maxDistanceThresholdY + 1;
+	begin[2] -= _maxDistanceThresholdZ + 1;
+	end[0]   += _maxDistanceThresholdX + 1;
+	end[1]   += _maxDistanceThresholdY + 1;
+	end[2]   += _maxDistanceThresholdZ + 1;
+}
+
+void
+DistanceToleranceFunction::initializeCellLabels(std::shared_ptr<Cells> cells) {
 
-	// the maximum boundary distance of any location for each cell
-	std::vector<float> maxBoundaryDistances(numCells, 0);
+	// every cell can at least keep it's original label
+	for (auto& cell : *cells)
+		cell.addPossibleLabel(cell.getReconstructionLabel());
+}
 
-	for (int cellIndex = 0; cellIndex < numCells; cellIndex++)
-		for (const auto& l : (*cells)[cellIndex])
-			maxBoundaryDistances[cellIndex] = std::max(
-					maxBoundaryDistances[cellIndex],
-					boundaryDistance2(l.x, l.y, l.z)
-			);
+std::vector<size_t>
+DistanceToleranceFunction::findRelabelCandidates(
+		std::shared_ptr<Cells> cells,
+		const ImageStack& recLabels,
+		const ImageStack& gtLabels) {
 
+	// a cell is a candidate, if none of its locations is marked as 
+	// non-candidate location
 	std::vector<size_t> relabelCandidates;
-	for (unsigned int cellIndex = 0; cellIndex < maxBoundaryDistances.size(); cellIndex++)
-		if (maxBoundaryDistances[cellIndex] <= _maxDistanceThreshold*_maxDistanceThreshold)
+	for (unsigned int cellIndex = 0; cellIndex < cells->size(); cellIndex++) {
+
+		const Cell<size_t>& cell = (*cells)[cellIndex];
+
+		// lazy cells are known to contain non-candidate locations
+		if (cell.isLazy())
+			continue;
+
+		bool isCandidate = true;
+		for (const Cell<size_t>::Run& run : cell.getRuns()) {
+
+			for (int x = run.xBegin; x < run.xEnd; x++)
+				if (_nonCandidateLocations(x, run.y, run.z)) {
+
+					isCandidate = false;
+					break;
+				}
+
+			if (!isCandidate)
+				break;
+		}
+
+		if (isCandidate)
 			relabelCandidates.push_back(cellIndex);
+	}
 
 	return relabelCandidates;
 }
@@ -167,6 +406,19 @@ DistanceToleranceFunction::createBoundaryMap(const ImageStack& recLabels) {
 					_boundaryMap(x, y, z) = 1.0f;
 }
 
+void
+DistanceToleranceFunction::updateBoundaryMap(
+		const ImageStack& recLabels,
+		const vigra::Shape3& changedBegin,
+		const vigra::Shape3& changedEnd) {
+
+	// a location is a boundary depending on its direct neighbors
+	for (int z = std::max(0, (int)changedBegin[2] - 1); z < std::min((int)_depth, (int)changedEnd[2] + 1); z++)
+		for (int y = std::max(0, (int)changedBegin[1] - 1); y < std::min((int)_height, (int)changedEnd[1] + 1); y++)
+			for (int x = std::max(0, (int)changedBegin[0] - 1); x < std::min((int)_width, (int)changedEnd[0] + 1); x++)
+				_boundaryMap(x, y, z) = isBoundaryVoxel(x, y, z, recLabels);
+}
+
 bool
 DistanceToleranceFunction::isBoundaryVoxel(int x, int y, int z, const ImageStack& stack) {
 
@@ -340,3 +592,246 @@ DistanceToleranceFunction::getAlternativeLabels(
 
 	return alternativeLabels;
 }
+
+std::vector<std::set<size_t>>
+DistanceToleranceFunction::getAlternativeLabelsByDistanceTransform(
+		const Cells& cells,
+		const std::vector<size_t>& relabelCandidates,
+		const ImageStack& recLabels) {
+
+	LOG_DEBUG(distancetolerancelog) << "finding reconstruction labels close to relabel candidates" << std::endl;
+
+	// the bounding box of each relabel candidate
+	std::vector<vigra::Shape3> boxBegin(relabelCandidates.size());
+	std::vector<vigra::Shape3> boxEnd(relabelCandidates.size());
+
+	// the labels close to each relabel candidate
+	std::vector<std::set<size_t>> closeLabels(relabelCandidates.size());
+
+	parallelFor(
+			relabelCandidates.size(),
+			_numThreads,
+			[&](size_t i) {
+
+				const Cell<size_t>& cell = cells[relabelCandidates[i]];
+
+				getBoundingBox(cell, boxBegin[i], boxEnd[i]);
+				closeLabels[i] = getCloseLabels(cell, recLabels);
+			});
+
+	// the relabel candidates that are close to each reconstruction label
+	std::map<size_t, std::vector<unsigned int>> candidatesByLabel;
+	for (unsigned int i = 0; i < relabelCandidates.size(); i++)
+		for (size_t label : closeLabels[i])
+			candidatesByLabel[label].push_back(i);
+
+	std::vector<size_t> labels;
+	for (const auto& p : candidatesByLabel)
+		labels.push_back(p.first);
+
+	LOG_DEBUG(distancetolerancelog) << "computing distance transforms for " << labels.size() << " reconstruction labels" << std::endl;
+
+	// the candidates that are covered by each label
+	std::vector<std::vector<unsigned int>> coveredCandidates(labels.size());
+
+	parallelFor(
+			labels.size(),
+			_numThreads,
+			[&](size_t j) {
+
+				const std::vector<unsigned int>& candidates = candidatesByLabel.at(labels[j]);
+
+				// the bounding box of all candidates
+				vigra::Shape3 begin(_width, _height, _depth);
+				vigra::Shape3 end(0, 0, 0);
+				for (unsigned int i : candidates)
+					for (int d = 0; d < 3; d++) {
+
+						begin[d] = std::min(begin[d], boxBegin[i][d]);
+						end[d]   = std::max(end[d],   boxEnd[i][d]);
+					}
+
+				std::vector<const Cell<size_t>*> candidateCells;
+				for (unsigned int i : candidates)
+					candidateCells.push_back(&cells[relabelCandidates[i]]);
+
+				std::vector<bool> covered = getCoveredCells(labels[j], candidateCells, begin, end, recLabels);
+
+				for (unsigned int k = 0; k < candidates.size(); k++)
+					if (covered[k])
+						coveredCandidates[j].push_back(candidates[k]);
+			});
+
+	std::vector<std::set<size_t>> alternativeLabels(relabelCandidates.size());
+	for (unsigned int j = 0; j < labels.size(); j++)
+		for (unsigned int i : coveredCandidates[j])
+			alternativeLabels[i].insert(labels[j]);
+
+	return alternativeLabels;
+}
+
+void
+DistanceToleranceFunction::getBoundingBox(
+		const Cell<size_t>& cell,
+		vigra::Shape3& begin,
+		vigra::Shape3& end) {
+
+	begin = vigra::Shape3(_width, _height, _depth);
+	end   = vigra::Shape3(0, 0, 0);
+
+	for (const Cell<size_t>::Run& run : cell.getRuns()) {
+
+		begin[0] = std::min(begin[0], (std::ptrdiff_t)run.xBegin);
+		begin[1] = std::min(begin[1], (std::ptrdiff_t)run.y);
+		begin[2] = std::min(begin[2], (std::ptrdiff_t)run.z);
+		end[0]   = std::max(end[0],   (std::ptrdiff_t)run.xEnd);
+		end[1]   = std::max(end[1],   (std::ptrdiff_t)run.y + 1);
+		end[2]   = std::max(end[2],   (std::ptrdiff_t)run.z + 1);
+	}
+}
+
+std::set<size_t>
+DistanceToleranceFunction::getCloseLabels(
+		const Cell<size_t>& cell,
+		const ImageStack& recLabels) {
+
+	std::set<size_t> closeLabels;
+
+	if (cell.size() == 0)
+		return closeLabels;
+
+	size_t cellLabel = cell.getReconstructionLabel();
+	float  maxDistance2 = _maxDistanceThreshold*_maxDistanceThreshold;
+
+	// An alternative label has to be within the threshold distance of every 
+	// location of the cell, in particular of the first one. Collect all labels 
+	// of boundary locations close to it.
+	Cell<size_t>::Location first = cell.getSeed();
+
+	for (int z = std::max(0, first.z - _maxDistanceThresholdZ); z <= std::min((int)_depth - 1, first.z + _maxDistanceThresholdZ); z++)
+		for (int y = std::max(0, first.y - _maxDistanceThresholdY); y <= std::min((int)_height - 1, first.y + _maxDistanceThresholdY); y++)
+			for (int x = std::max(0, first.x - _maxDistanceThresholdX); x <= std::min((int)_width - 1, first.x + _maxDistanceThresholdX); x++) {
+
+				if (!_boundaryMap(x, y, z))
+					continue;
+
+				int dx = x - first.x;
+				int dy = y - first.y;
+				int dz = z - first.z;
+
+				if (
+						dx*_resolutionX*dx*_resolutionX +
+						dy*_resolutionY*dy*_resolutionY +
+						dz*_resolutionZ*dz*_resolutionZ > maxDistance2)
+					continue;
+
+				size_t label = (*recLabels[z])(x, y);
+
+				if (label != cellLabel)
+					closeLabels.insert(label);
+			}
+
+	return closeLabels;
+}
+
+std::vector<bool>
+DistanceToleranceFunction::getCoveredCells(
+		size_t label,
+		const std::vector<const Cell<size_t>*>& cells,
+		vigra::Shape3 begin,
+		vigra::Shape3 end,
+		const ImageStack& recLabels) {
+
+	float maxDistance2 = _maxDistanceThreshold*_maxDistanceThreshold;
+
+	std::vector<float> distances = getCoveringDistances(label, cells, begin, end, recLabels);
+
+	std::vector<bool> covered(cells.size());
+	for (unsigned int i = 0; i < cells.size(); i++)
+		covered[i] = (distances[i] <= maxDistance2);
+
+	return covered;
+}
+
+std::vector<float>
+DistanceToleranceFunction::getCoveringDistances(
+		size_t label,
+		const std::vector<const Cell<size_t>*>& cells,
+		vigra::Shape3 begin,
+		vigra::Shape3 end,
+		const ImageStack& recLabels) {
+
+	float maxDistance2 = _maxDistanceThreshold*_maxDistanceThreshold;
+
+	// grow the box by the threshold distance -- locations outside of it are 
+	// further away from any of the cells than the threshold, so they can not 
+	// change the outcome
+	begin[0] = std::max((std::ptrdiff_t)0, begin[0] - _maxDistanceThresholdX);
+	begin[1] = std::max((std::ptrdiff_t)0, begin[1] - _maxDistanceThresholdY);
+	begin[2] = std::max((std::ptrdiff_t)0, begin[2] - _maxDistanceThresholdZ);
+	end[0]   = std::min((std::ptrdiff_t)_width,  end[0] + _maxDistanceThresholdX);
+	end[1]   = std::min((std::ptrdiff_t)_height, end[1] + _maxDistanceThresholdY);
+	end[2]   = std::min((std::ptrdiff_t)_depth,  end[2] + _maxDistanceThresholdZ);
+
+	vigra::Shape3 shape(
+			end[0] - begin[0],
+			end[1] - begin[1],
+			end[2] - begin[2]);
+
+	vigra::MultiArray<3, bool>  labelMask(shape);
+	vigra::MultiArray<3, float> labelDistance2(shape);
+
+	for (int z = 0; z < shape[2]; z++) {
+
+		std::shared_ptr<const Image> rec = recLabels[z + begin[2]];
+
+		for (int y = 0; y < shape[1]; y++)
+			for (int x = 0; x < shape[0]; x++)
+				labelMask(x, y, z) = ((*rec)(x + begin[0], y + begin[1]) == label);
+	}
+
+	float pitch[3];
+	pitch[0] = _resolutionX;
+	pitch[1] = _resolutionY;
+	pitch[2] = _resolutionZ;
+
+	vigra::separableMultiDistSquared(
+			labelMask,
+			labelDistance2,
+			true /* background */,
+			pitch);
+
+	// the covering distance of a cell is the largest distance of one of its 
+	// locations, stop as soon as it exceeds the threshold distance
+	std::vector<float> distances(cells.size(), 0);
+	for (unsigned int i = 0; i < cells.size(); i++)
+		for (const Cell<size_t>::Run& run : cells[i]->getRuns()) {
+
+			for (int x = run.xBegin; x < run.xEnd; x++)
+				distances[i] = std::max(distances[i], labelDistance2(x - begin[0], run.y - begin[1], run.z - begin[2]));
+
+			if (distances[i] > maxDistance2)
+				break;
+		}
+
+	return distances;
+}
+
+std::vector<unsigned int>
+DistanceToleranceFunction::getProcessingOrder(
+		const Cells& cells,
+		const std::vector<size_t>& relabelCandidates) {
+
+	std::vector<unsigned int> order(relabelCandidates.size());
+	for (unsigned int i = 0; i < order.size(); i++)
+		order[i] = i;
+
+	std::stable_sort(
+			order.begin(),
+			order.end(),
+			[&](unsigned int a, unsigned int b) {
+				return cells[relabelCandidates[a]].size() > cells[relabelCandidates[b]].size();
+			});
+
+	return order;
+}
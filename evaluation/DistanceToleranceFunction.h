@@ -7,6 +7,25 @@ class DistanceToleranceFunction : public LocalToleranceFunction {
 
 public:
 
+	/**
+	 * Methods to find the alternative labels of a cell.
+	 */
+	enum AlternativeLabelSearch {
+
+		/**
+		 * Scan the spherical threshold neighborhood of every location of a 
+		 * cell for boundaries of other labels.
+		 */
+		NeighborhoodScan,
+
+		/**
+		 * Compute a bounded distance transform for each reconstruction label 
+		 * near a cell and compare the maximal distance of the cell to it 
+		 * against the threshold.
+		 */
+		DistanceTransform
+	};
+
 	/**
 	 * @param distanceThreshold
 	 *              By how much boundaries in the reconstruction are allowed to 
@@ -17,19 +36,85 @@ public:
 	 *              parts appear.
 	 * @param recBackgroundLabel
 	 *              The background label.
+	 * @param alternativeLabelSearch
+	 *              The method to find alternative labels for each cell.
 	 */
 	DistanceToleranceFunction(
 			float distanceThreshold,
 			bool allowBackgroundAppearance,
-			size_t recBackgroundLabel = 0);
+			size_t recBackgroundLabel = 0,
+			AlternativeLabelSearch alternativeLabelSearch = NeighborhoodScan);
+
+	/**
+	 * Change the distance threshold for the following calls to 
+	 * extractCells().
+	 */
+	void setDistanceThreshold(float distanceThreshold) { _maxDistanceThreshold = distanceThreshold; }
 
 	virtual void findPossibleCellLabels(
 			std::shared_ptr<Cells> cells,
 			const ImageStack& gtLabels,
 			const ImageStack& recLabels) override;
 
+	/**
+	 * For cells extracted with the current distance threshold, find the 
+	 * smallest threshold for which each of their possible labels is possible 
+	 * as well. The possible labels for a smaller threshold are a subset of 
+	 * the current ones.
+	 *
+	 * @return
+	 *             For each cell, the squared threshold of each possible 
+	 *             label, in the order of Cell::getPossibleLabels(). 0 for the 
+	 *             original label.
+	 */
+	std::vector<std::vector<float>> getPossibleLabelDistances(
+			const Cells& cells,
+			const ImageStack& recLabels);
+
 protected:
 
+	/**
+	 * Mark all locations that are further away from a boundary in the 
+	 * reconstruction than the distance threshold.
+	 */
+	virtual void findNonCandidateLocations(
+			const ImageStack& gtLabels,
+			const ImageStack& recLabels) override;
+
+	/**
+	 * Update the boundaries, and the non-candidate locations within the 
+	 * distance threshold of changed boundaries.
+	 */
+	virtual void updateNonCandidateLocations(
+			const ImageStack& gtLabels,
+			const ImageStack& recLabels,
+			const vigra::Shape3& changedBegin,
+			const vigra::Shape3& changedEnd) override;
+
+	/**
+	 * Grow the box by the distance threshold and one more location, since 
+	 * the alternative labels of a cell are found among the boundaries within 
+	 * the threshold distance.
+	 */
+	virtual void growChangedBox(vigra::Shape3& begin, vigra::Shape3& end) override;
+
+	/**
+	 * Update the boundaries after the reconstruction changed inside the box 
+	 * [changedBegin, changedEnd).
+	 */
+	void updateBoundaryMap(
+			const ImageStack& recLabels,
+			const vigra::Shape3& changedBegin,
+			const vigra::Shape3& changedEnd);
+
+	/**
+	 * Set the extends and resolution of the volume, and find the boundaries 
+	 * in the reconstruction. Has to be called before cells are extracted.
+	 */
+	void initialize(
+			const ImageStack& gtLabels,
+			const ImageStack& recLabels);
+
 	/**
 	 * Initialize cells, before an expensive search for possible labels. This is 
 	 * the last chance to change a cell's reconstruction label.
@@ -67,6 +152,51 @@ private:
 			const std::vector<Cell<size_t>::Location>& neighborhood,
 			const ImageStack& recLabels);
 
+	// search for all relabeling alternatives of the given relabel candidates, 
+	// using one distance transform per reconstruction label
+	std::vector<std::set<size_t>> getAlternativeLabelsByDistanceTransform(
+			const Cells& cells,
+			const std::vector<size_t>& relabelCandidates,
+			const ImageStack& recLabels);
+
+	// get the bounding box of a cell
+	void getBoundingBox(
+			const Cell<size_t>& cell,
+			vigra::Shape3& begin,
+			vigra::Shape3& end);
+
+	// get all labels of boundary locations that are within the threshold 
+	// distance of the first location of the given cell
+	std::set<size_t> getCloseLabels(
+			const Cell<size_t>& cell,
+			const ImageStack& recLabels);
+
+	// for each of the given cells, test whether it is completely within the 
+	// threshold distance of the given label, using a distance transform of 
+	// the label inside the bounding box of the cells
+	std::vector<bool> getCoveredCells(
+			size_t label,
+			const std::vector<const Cell<size_t>*>& cells,
+			vigra::Shape3 begin,
+			vigra::Shape3 end,
+			const ImageStack& recLabels);
+
+	// for each of the given cells, get the largest squared distance of one of 
+	// its locations to the given label, or a value larger than the squared 
+	// threshold distance if the cell is not covered by the label
+	std::vector<float> getCoveringDistances(
+			size_t label,
+			const std::vector<const Cell<size_t>*>& cells,
+			vigra::Shape3 begin,
+			vigra::Shape3 end,
+			const ImageStack& recLabels);
+
+	// get the order in which to process the relabel candidates (as indices 
+	// into relabelCandidates), largest cells first
+	std::vector<unsigned int> getProcessingOrder(
+			const Cells& cells,
+			const std::vector<size_t>& relabelCandidates);
+
 	// test, whether a voxel is surrounded by at least one other voxel with a 
 	// different label
 	bool isBoundaryVoxel(int x, int y, int z, const ImageStack& stack);
@@ -74,6 +204,8 @@ private:
 	// the distance threshold in nm
 	float _maxDistanceThreshold;
 
+	AlternativeLabelSearch _alternativeLabelSearch;
+
 	// the distance threshold in pixels for each direction
 	int _maxDistanceThresholdX;
 	int _maxDistanceThresholdY;
@@ -1,6 +1,13 @@
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <limits>
+
 #include <vigra/multi_labeling.hxx>
+#include <util/exceptions.h>
 #include <util/Logger.h>
 #include "LocalToleranceFunction.h"
+#include "Parallel.h"
 
 logger::LogChannel localtolerancefunctionlog("localtolerancefunctionlog", "[LocalToleranceFunction] ");
 
@@ -9,6 +16,280 @@ LocalToleranceFunction::extractCells(
 		const ImageStack& groundTruth,
 		const ImageStack& reconstruction) {
 
+	// let subclasses mark locations of cells that will not be relabeled
+	_nonCandidateLocations.reshape(vigra::Shape3(0, 0, 0));
+	findNonCandidateLocations(groundTruth, reconstruction);
+
+	std::shared_ptr<Cells> cells;
+
+	if (_cellExtraction == FusedUnionFind)
+		cells = extractCellsFused(groundTruth, reconstruction, 1);
+	else if (_cellExtraction == BlockwiseUnionFind)
+		cells = extractCellsFused(groundTruth, reconstruction, getNumWorkerThreads(_numThreads));
+
+	// the fused extraction can not handle all labels
+	if (!cells)
+		cells = extractCellsVigra(groundTruth, reconstruction);
+
+	cells->setLabelImages(groundTruth, reconstruction);
+
+	// delegate label enumeration to subclasses
+	findPossibleCellLabels(cells, groundTruth, reconstruction);
+
+	return cells;
+}
+
+std::shared_ptr<Cells>
+LocalToleranceFunction::updateCells(
+		const Cells& previousCells,
+		const ImageStack& groundTruth,
+		const ImageStack& previousReconstruction,
+		const ImageStack& reconstruction,
+		const vigra::Shape3& changedBegin,
+		const vigra::Shape3& changedEnd,
+		std::vector<unsigned int>& previousCellIndices) {
+
+	vigra::Shape3 shape(groundTruth.width(), groundTruth.height(), groundTruth.size());
+
+	bool changed = true;
+	for (int d = 0; d < 3; d++)
+		if (changedEnd[d] <= changedBegin[d])
+			changed = false;
+
+	// the box of cells to extract again
+
+	vigra::Shape3 begin(0, 0, 0);
+	vigra::Shape3 end(0, 0, 0);
+
+	if (changed) {
+
+		updateNonCandidateLocations(groundTruth, reconstruction, changedBegin, changedEnd);
+
+		begin = changedBegin;
+		end   = changedEnd;
+		growChangedBox(begin, end);
+
+		for (int d = 0; d < 3; d++) {
+
+			begin[d] = std::max(begin[d], (std::ptrdiff_t)0);
+			end[d]   = std::min(end[d], shape[d]);
+		}
+	}
+
+	LOG_DEBUG(localtolerancefunctionlog)
+			<< "updating cells in " << begin << " to " << end << std::endl;
+
+	// the previous cells in the box are replaced by the cells in the box now
+
+	std::vector<std::vector<Cell<size_t>::Run>> previousRuns = floodFillBox(groundTruth, previousReconstruction, begin, end);
+	std::vector<std::vector<Cell<size_t>::Run>> newRuns      = floodFillBox(groundTruth, reconstruction, begin, end);
+
+	LOG_DEBUG(localtolerancefunctionlog)
+			<< "replacing " << previousRuns.size() << " of " << previousCells.size()
+			<< " cells by " << newRuns.size() << " new ones" << std::endl;
+
+	// cells are in the order of their seeds, find previous cells by seed
+	auto findPreviousCell = [&](const Cell<size_t>::Location& seed) {
+
+		auto i = std::lower_bound(
+				previousCells.begin(),
+				previousCells.end(),
+				seed,
+				[](const Cell<size_t>& cell, const Cell<size_t>::Location& location) {
+					return cell.getSeed() < location;
+				});
+
+		if (i == previousCells.end() || i->getSeed() < seed || seed < i->getSeed())
+			return (unsigned int)Cells::NoCell;
+
+		return (unsigned int)(i - previousCells.begin());
+	};
+
+	std::vector<char> replaced(previousCells.size(), false);
+	for (const std::vector<Cell<size_t>::Run>& runs : previousRuns) {
+
+		unsigned int previousCell = findPreviousCell(Cell<size_t>::Location(runs[0].xBegin, runs[0].y, runs[0].z));
+
+		if (previousCell == Cells::NoCell)
+			UTIL_THROW_EXCEPTION(
+					UsageError,
+					"the previous cells were not extracted from the previous reconstruction");
+
+		replaced[previousCell] = true;
+	}
+
+	// the new cells, lazy if they contain a non-candidate location
+
+	std::vector<size_t> numRuns(newRuns.size(), 0);
+	std::vector<char>   nonCandidate(newRuns.size(), false);
+
+	for (unsigned int i = 0; i < newRuns.size(); i++) {
+
+		if (_nonCandidateLocations.size() > 0)
+			for (const Cell<size_t>::Run& run : newRuns[i])
+				for (int x = run.xBegin; x < run.xEnd; x++)
+					if (_nonCandidateLocations(x, run.y, run.z))
+						nonCandidate[i] = true;
+
+		if (!nonCandidate[i])
+			numRuns[i] = newRuns[i].size();
+	}
+
+	std::shared_ptr<Cells> newCells = std::make_shared<Cells>(numRuns);
+
+	for (unsigned int i = 0; i < newRuns.size(); i++) {
+
+		Cell<size_t>& cell = (*newCells)[i];
+		Cell<size_t>::Location seed(newRuns[i][0].xBegin, newRuns[i][0].y, newRuns[i][0].z);
+
+		if (nonCandidate[i]) {
+
+			unsigned int size = 0;
+			for (const Cell<size_t>::Run& run : newRuns[i])
+				size += run.xEnd - run.xBegin;
+
+			newCells->setLazy(i, seed, size);
+
+		} else {
+
+			for (const Cell<size_t>::Run& run : newRuns[i])
+				cell.add(run);
+		}
+
+		cell.setGroundTruthLabel((*groundTruth[seed.z])(seed.x, seed.y));
+		cell.setReconstructionLabel((*reconstruction[seed.z])(seed.x, seed.y));
+	}
+
+	newCells->setLabelImages(groundTruth, reconstruction);
+
+	findPossibleCellLabels(newCells, groundTruth, reconstruction);
+
+	// merge the kept previous cells and the new cells in the order of their 
+	// seeds
+
+	std::vector<unsigned int> keptCells;
+	for (unsigned int i = 0; i < previousCells.size(); i++)
+		if (!replaced[i])
+			keptCells.push_back(i);
+
+	// (is new, index) of each cell
+	std::vector<std::pair<bool, unsigned int>> order;
+	order.reserve(keptCells.size() + newCells->size());
+
+	unsigned int k = 0;
+	unsigned int n = 0;
+	while (k < keptCells.size() || n < newCells->size()) {
+
+		if (n == newCells->size() || (k < keptCells.size() && previousCells[keptCells[k]].getSeed() < (*newCells)[n].getSeed()))
+			order.push_back(std::make_pair(false, keptCells[k++]));
+		else
+			order.push_back(std::make_pair(true, n++));
+	}
+
+	std::vector<size_t> cellNumRuns(order.size(), 0);
+	for (unsigned int i = 0; i < order.size(); i++) {
+
+		const Cell<size_t>& cell = (order[i].first ? (*newCells)[order[i].second] : previousCells[order[i].second]);
+
+		if (!cell.isLazy())
+			cellNumRuns[i] = cell.getRuns().size();
+	}
+
+	std::shared_ptr<Cells> cells = std::make_shared<Cells>(cellNumRuns);
+	previousCellIndices.assign(order.size(), Cells::NoCell);
+
+	for (unsigned int i = 0; i < order.size(); i++) {
+
+		const Cell<size_t>& source = (order[i].first ? (*newCells)[order[i].second] : previousCells[order[i].second]);
+		Cell<size_t>& cell = (*cells)[i];
+
+		if (source.isLazy())
+			cells->setLazy(i, source.getSeed(), source.size());
+		else
+			for (const Cell<size_t>::Run& run : source.getRuns())
+				cell.add(run);
+
+		cell.setGroundTruthLabel(source.getGroundTruthLabel());
+		cell.setReconstructionLabel(source.getReconstructionLabel());
+		for (size_t l : source.getPossibleLabels())
+			cell.addPossibleLabel(l);
+
+		if (!order[i].first) {
+
+			previousCellIndices[i] = order[i].second;
+			continue;
+		}
+
+		// a new cell that might enter the ILP the same way as before
+		unsigned int previousCell = findPreviousCell(source.getSeed());
+		if (previousCell == Cells::NoCell)
+			continue;
+
+		const Cell<size_t>& previous = previousCells[previousCell];
+		if (
+				previous.getGroundTruthLabel()    == source.getGroundTruthLabel() &&
+				previous.getReconstructionLabel() == source.getReconstructionLabel() &&
+				previous.size()                   == source.size())
+			previousCellIndices[i] = previousCell;
+	}
+
+	cells->setLabelImages(groundTruth, reconstruction);
+
+	return cells;
+}
+
+std::vector<std::vector<Cell<size_t>::Run>>
+LocalToleranceFunction::floodFillBox(
+		const ImageStack& groundTruth,
+		const ImageStack& reconstruction,
+		const vigra::Shape3& begin,
+		const vigra::Shape3& end) {
+
+	std::vector<std::vector<Cell<size_t>::Run>> cellRuns;
+
+	for (int d = 0; d < 3; d++)
+		if (end[d] <= begin[d])
+			return cellRuns;
+
+	// the locations in the box that belong to a cell found already
+	vigra::MultiArray<3, bool> visited(vigra::Shape3(end[0] - begin[0], end[1] - begin[1], end[2] - begin[2]));
+	visited = false;
+
+	for (int z = begin[2]; z < end[2]; z++)
+		for (int y = begin[1]; y < end[1]; y++)
+			for (int x = begin[0]; x < end[0]; x++) {
+
+				if (visited(x - begin[0], y - begin[1], z - begin[2]))
+					continue;
+
+				cellRuns.push_back(Cells::floodFill(groundTruth, reconstruction, Cell<size_t>::Location(x, y, z)));
+
+				for (const Cell<size_t>::Run& run : cellRuns.back()) {
+
+					if (run.z < begin[2] || run.z >= end[2] || run.y < begin[1] || run.y >= end[1])
+						continue;
+
+					for (int rx = std::max(run.xBegin, (int)begin[0]); rx < std::min(run.xEnd, (int)end[0]); rx++)
+						visited(rx - begin[0], run.y - begin[1], run.z - begin[2]) = true;
+				}
+			}
+
+	// the runs are in scan order, the first one starts with the seed
+	std::sort(
+			cellRuns.begin(),
+			cellRuns.end(),
+			[](const std::vector<Cell<size_t>::Run>& a, const std::vector<Cell<size_t>::Run>& b) {
+				return a[0] < b[0];
+			});
+
+	return cellRuns;
+}
+
+std::shared_ptr<Cells>
+LocalToleranceFunction::extractCellsVigra(
+		const ImageStack& groundTruth,
+		const ImageStack& reconstruction) {
+
 	size_t depth  = groundTruth.size();
 	size_t width  = groundTruth.width();
 	size_t height = groundTruth.height();
@@ -44,15 +325,22 @@ LocalToleranceFunction::extractCells(
 
 	// extract cells from connected components
 
-	std::shared_ptr<Cells> cells = std::make_shared<Cells>(numCells);
+	std::vector<size_t> numRuns(numCells, 0);
+	for (unsigned int z = 0; z < depth; z++)
+		for (unsigned int y = 0; y < height; y++)
+			for (unsigned int x = 0; x < width; x++)
+				if (x == 0 || cellIds(x - 1, y, z) != cellIds(x, y, z))
+					numRuns[cellIds(x, y, z) - 1]++;
+
+	std::shared_ptr<Cells> cells = std::make_shared<Cells>(numRuns);
 
 	for (unsigned int z = 0; z < depth; z++) {
 
 		std::shared_ptr<const Image> gt  = groundTruth[z];
 		std::shared_ptr<const Image> rec = reconstruction[z];
 
-		for (unsigned int x = 0; x < width; x++)
-			for (unsigned int y = 0; y < height; y++) {
+		for (unsigned int y = 0; y < height; y++)
+			for (unsigned int x = 0; x < width; x++) {
 
 				size_t gtLabel  = (*gt)(x, y);
 				size_t recLabel = (*rec)(x, y);
@@ -66,8 +354,351 @@ LocalToleranceFunction::extractCells(
 			}
 	}
 
-	// delegate label enumeration to subclasses
-	findPossibleCellLabels(cells, groundTruth, reconstruction);
+	return cells;
+}
+
+std::shared_ptr<Cells>
+LocalToleranceFunction::extractCellsFused(
+		const ImageStack& groundTruth,
+		const ImageStack& reconstruction,
+		unsigned int numSlabs) {
+
+	size_t depth  = groundTruth.size();
+	size_t width  = groundTruth.width();
+	size_t height = groundTruth.height();
+
+	numSlabs = std::max(std::min(numSlabs, (unsigned int)depth), 1u);
+
+	LOG_ALL(localtolerancefunctionlog)
+			<< "extracting cells in " << width << "x" << height << "x" << depth
+			<< " volume in " << numSlabs << " slabs" << std::endl;
+
+	// label each slab independently
+
+	std::vector<Slab> slabs(numSlabs);
+	for (unsigned int s = 0; s < numSlabs; s++) {
+
+		slabs[s].zBegin = (s*depth)/numSlabs;
+		slabs[s].zEnd   = ((s + 1)*depth)/numSlabs;
+	}
+
+	std::vector<char> valid(numSlabs);
+	parallelFor(
+			numSlabs,
+			numSlabs,
+			[&](size_t s) { valid[s] = labelSlab(groundTruth, reconstruction, slabs[s]); });
+
+	for (unsigned int s = 0; s < numSlabs; s++)
+		if (!valid[s]) {
+
+			LOG_DEBUG(localtolerancefunctionlog)
+					<< "labels exceed 32 bit, falling back to vigra labeling"
+					<< std::endl;
+			return std::shared_ptr<Cells>();
+		}
+
+	// Give the provisional ids of all slabs consecutive global ids. Since 
+	// slabs are in z order, the smallest global id of each component is still 
+	// the one of its first location in scan order.
+
+	std::vector<unsigned int> offsets(numSlabs + 1, 0);
+	for (unsigned int s = 0; s < numSlabs; s++)
+		offsets[s + 1] = offsets[s] + slabs[s].components.size();
+
+	ConcurrentUnionFind<unsigned int> components(offsets[numSlabs]);
+	parallelFor(
+			numSlabs,
+			numSlabs,
+			[&](size_t s) {
+				for (unsigned int id = 0; id < slabs[s].components.size(); id++)
+					components.setParent(offsets[s] + id, offsets[s] + slabs[s].components.find(id));
+			});
+
+	// merge components across slab faces
+
+	parallelFor(
+			numSlabs - 1,
+			numSlabs,
+			[&](size_t f) {
+
+				const Slab& above = slabs[f];
+				const Slab& below = slabs[f + 1];
+
+				const Image& gtAbove  = *groundTruth[below.zBegin - 1];
+				const Image& recAbove = *reconstruction[below.zBegin - 1];
+				const Image& gtBelow  = *groundTruth[below.zBegin];
+				const Image& recBelow = *reconstruction[below.zBegin];
+
+				for (unsigned int y = 0; y < height; y++)
+					for (unsigned int x = 0; x < width; x++) {
+
+						size_t gtLabel  = gtBelow(x, y);
+						size_t recLabel = recBelow(x, y);
+						unsigned int id = offsets[f + 1] + below.firstIds[y*width + x];
+
+						for (int dy = -1; dy <= 1; dy++)
+							for (int dx = -1; dx <= 1; dx++) {
+
+								if ((x == 0 && dx < 0) || (x == width - 1 && dx > 0))
+									continue;
+								if ((y == 0 && dy < 0) || (y == height - 1 && dy > 0))
+									continue;
+
+								if ((size_t)gtAbove(x + dx, y + dy) == gtLabel && (size_t)recAbove(x + dx, y + dy) == recLabel)
+									components.merge(
+											id,
+											offsets[f] + above.lastIds[(y + dy)*width + x + dx]);
+							}
+					}
+			});
+
+	// Number cells in the order of their representatives, which is the order 
+	// vigra would use.
+
+	std::vector<unsigned int> cellIndices(components.size());
+	unsigned int numCells = 0;
+	for (unsigned int id = 0; id < components.size(); id++)
+		if (components.find(id) == id)
+			cellIndices[id] = numCells++;
+
+	LOG_DEBUG(localtolerancefunctionlog) << "found " << numCells << " cells" << std::endl;
+
+	// collect the size, seed location, and labels of each cell
+
+	std::vector<unsigned int>           sizes(numCells, 0);
+	std::vector<Cell<size_t>::Location> seeds(numCells, Cell<size_t>::Location(0, 0, 0));
+	std::vector<std::pair<size_t, size_t>> labels(numCells);
+	std::vector<char>                   nonCandidate(numCells, false);
+
+	for (unsigned int s = 0; s < numSlabs; s++)
+		for (unsigned int id = 0; id < slabs[s].components.size(); id++) {
+
+			unsigned int root      = components.find(offsets[s] + id);
+			unsigned int cellIndex = cellIndices[root];
+
+			sizes[cellIndex] += slabs[s].sizes[id];
+			nonCandidate[cellIndex] |= slabs[s].nonCandidate[id];
+
+			if (root == offsets[s] + id) {
+
+				seeds[cellIndex]  = slabs[s].seeds[id];
+				labels[cellIndex] = slabs[s].labels[id];
+			}
+		}
+
+	std::vector<size_t> numRuns(numCells, 0);
+	std::shared_ptr<Cells> cells;
+
+	if (_nonCandidateLocations.size() == 0) {
+
+		// all cells are materialized from the runs found during labeling
+
+		for (unsigned int s = 0; s < numSlabs; s++)
+			for (unsigned int id = 0; id < slabs[s].components.size(); id++)
+				numRuns[cellIndices[components.find(offsets[s] + id)]] += slabs[s].contents[id].size();
+
+		cells = std::make_shared<Cells>(numRuns);
+
+		for (unsigned int s = 0; s < numSlabs; s++) {
+
+			Slab& slab = slabs[s];
+
+			for (unsigned int id = 0; id < slab.components.size(); id++) {
+
+				Cell<size_t>& cell = (*cells)[cellIndices[components.find(offsets[s] + id)]];
+
+				for (const Cell<size_t>::Run& run : slab.contents[id])
+					cell.add(run);
+
+				// free memory early
+				std::vector<Cell<size_t>::Run>().swap(slab.contents[id]);
+			}
+		}
+
+		// The runs of a cell were added one provisional id at a time, bring 
+		// them into scan order, as for the flood-filled cells.
+		parallelFor(
+				numCells,
+				_numThreads,
+				[&](size_t cellIndex) {
+					(*cells)[cellIndex].sortRuns();
+				});
+
+	} else {
+
+		// only the candidate cells are materialized, with a flood fill from 
+		// their seed
+
+		std::vector<unsigned int> candidates;
+		for (unsigned int cellIndex = 0; cellIndex < numCells; cellIndex++)
+			if (!nonCandidate[cellIndex])
+				candidates.push_back(cellIndex);
+
+		LOG_DEBUG(localtolerancefunctionlog)
+				<< "materializing " << candidates.size() << " candidate cells, "
+				<< (numCells - candidates.size()) << " cells are lazy" << std::endl;
+
+		std::vector<std::vector<Cell<size_t>::Run>> candidateRuns(candidates.size());
+		parallelFor(
+				candidates.size(),
+				_numThreads,
+				[&](size_t i) {
+					candidateRuns[i] = Cells::floodFill(groundTruth, reconstruction, seeds[candidates[i]]);
+				});
+
+		for (unsigned int i = 0; i < candidates.size(); i++)
+			numRuns[candidates[i]] = candidateRuns[i].size();
+
+		cells = std::make_shared<Cells>(numRuns);
+
+		for (unsigned int i = 0; i < candidates.size(); i++) {
+
+			for (const Cell<size_t>::Run& run : candidateRuns[i])
+				(*cells)[candidates[i]].add(run);
+
+			std::vector<Cell<size_t>::Run>().swap(candidateRuns[i]);
+		}
+
+		for (unsigned int cellIndex = 0; cellIndex < numCells; cellIndex++)
+			if (nonCandidate[cellIndex])
+				cells->setLazy(cellIndex, seeds[cellIndex], sizes[cellIndex]);
+	}
+
+	for (unsigned int cellIndex = 0; cellIndex < numCells; cellIndex++) {
+
+		assert((*cells)[cellIndex].size() == sizes[cellIndex]);
+
+		(*cells)[cellIndex].setGroundTruthLabel(labels[cellIndex].first);
+		(*cells)[cellIndex].setReconstructionLabel(labels[cellIndex].second);
+	}
 
 	return cells;
 }
+
+bool
+LocalToleranceFunction::labelSlab(
+		const ImageStack& groundTruth,
+		const ImageStack& reconstruction,
+		Slab& slab) {
+
+	const unsigned int NoId = std::numeric_limits<unsigned int>::max();
+	const size_t MaxPackedLabel = std::numeric_limits<uint32_t>::max();
+
+	size_t width  = groundTruth.width();
+	size_t height = groundTruth.height();
+	size_t sectionSize = width*height;
+
+	// runs are only needed if all cells are materialized, otherwise the 
+	// candidates are materialized later
+	bool collectRuns = (_nonCandidateLocations.size() == 0);
+
+	// (GT, REC) label pairs packed into one key, and provisional component ids 
+	// for the current and previous section
+	std::vector<uint64_t>     keys(sectionSize);
+	std::vector<uint64_t>     prevKeys(sectionSize);
+	std::vector<unsigned int> ids(sectionSize);
+	std::vector<unsigned int> prevIds(sectionSize);
+
+	for (unsigned int z = slab.zBegin; z < slab.zEnd; z++) {
+
+		std::shared_ptr<const Image> gt  = groundTruth[z];
+		std::shared_ptr<const Image> rec = reconstruction[z];
+
+		for (unsigned int y = 0; y < height; y++)
+			for (unsigned int x = 0; x < width; x++) {
+
+				size_t gtLabel  = (*gt)(x, y);
+				size_t recLabel = (*rec)(x, y);
+
+				if (gtLabel > MaxPackedLabel || recLabel > MaxPackedLabel)
+					return false;
+
+				size_t   i   = y*width + x;
+				uint64_t key = (static_cast<uint64_t>(gtLabel) << 32) | recLabel;
+
+				keys[i] = key;
+
+				// find the provisional id of the already visited neighbors 
+				// (in the indirect neighborhood) with the same key, and 
+				// merge if there are several
+
+				unsigned int id = NoId;
+				auto visit = [&](unsigned int neighborId) {
+
+					if (id == NoId)
+						id = neighborId;
+					else if (id != neighborId)
+						slab.components.merge(id, neighborId);
+				};
+
+				if (x > 0 && keys[i - 1] == key)
+					visit(ids[i - 1]);
+
+				if (y > 0)
+					for (int dx = -1; dx <= 1; dx++) {
+
+						if ((x == 0 && dx < 0) || (x == width - 1 && dx > 0))
+							continue;
+
+						size_t j = i - width + dx;
+						if (keys[j] == key)
+							visit(ids[j]);
+					}
+
+				if (z > slab.zBegin)
+					for (int dy = -1; dy <= 1; dy++)
+						for (int dx = -1; dx <= 1; dx++) {
+
+							if ((x == 0 && dx < 0) || (x == width - 1 && dx > 0))
+								continue;
+							if ((y == 0 && dy < 0) || (y == height - 1 && dy > 0))
+								continue;
+
+							size_t j = i + dy*width + dx;
+							if (prevKeys[j] == key)
+								visit(prevIds[j]);
+						}
+
+				// no neighbor with the same key, start a new component
+				if (id == NoId) {
+
+					id = slab.components.add();
+					slab.contents.push_back(std::vector<Cell<size_t>::Run>());
+					slab.labels.push_back(std::make_pair(gtLabel, recLabel));
+					slab.sizes.push_back(0);
+					slab.seeds.push_back(Cell<size_t>::Location(x, y, z));
+					slab.nonCandidate.push_back(false);
+				}
+
+				ids[i] = id;
+				slab.sizes[id]++;
+
+				if (collectRuns) {
+
+					// The left neighbor is visited first, so a location with 
+					// the same key as its left neighbor always continues the 
+					// same run.
+					std::vector<Cell<size_t>::Run>& runs = slab.contents[id];
+					if (x > 0 && keys[i - 1] == key)
+						runs.back().xEnd++;
+					else
+						runs.push_back(Cell<size_t>::Run(z, y, x, x + 1));
+
+				} else if (_nonCandidateLocations(x, y, z)) {
+
+					slab.nonCandidate[id] = true;
+				}
+			}
+
+		// remember the ids of the faces of this slab
+		if (z == slab.zBegin)
+			slab.firstIds = ids;
+		if (z == slab.zEnd - 1)
+			slab.lastIds = ids;
+
+		std::swap(keys, prevKeys);
+		std::swap(ids, prevIds);
+	}
+
+	return true;
+}
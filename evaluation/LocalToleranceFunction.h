@@ -8,6 +8,7 @@
 
 #include <imageprocessing/ImageStack.h>
 #include "Cells.h"
+#include "UnionFind.h"
 
 #include <vigra/multi_array.hxx>
 
@@ -19,8 +20,49 @@ class LocalToleranceFunction {
 
 public:
 
+	/**
+	 * Methods to extract cells from the ground truth and reconstruction.
+	 */
+	enum CellExtraction {
+
+		/**
+		 * Copy the ground truth and reconstruction labels into one volume, 
+		 * label it with vigra::labelMultiArray, and collect the cell 
+		 * locations in a second pass.
+		 */
+		VigraLabeling,
+
+		/**
+		 * Label connected components in a single pass over the ground truth 
+		 * and reconstruction in memory order, using a union-find over packed 
+		 * (GT, REC) keys, and collect the cell locations on the fly.
+		 */
+		FusedUnionFind,
+
+		/**
+		 * Split the volume into slabs of sections, label each slab on its own 
+		 * thread as in FusedUnionFind, and merge the labels across slab faces 
+		 * with a concurrent union-find.
+		 */
+		BlockwiseUnionFind
+	};
+
+	LocalToleranceFunction() :
+		_numThreads(0),
+		_cellExtraction(BlockwiseUnionFind) {}
+
 	virtual ~LocalToleranceFunction() {}
 
+	/**
+	 * Set the number of threads to use. 0 for all available hardware threads.
+	 */
+	void setNumThreads(unsigned int numThreads) { _numThreads = numThreads; }
+
+	/**
+	 * Set the method to extract cells.
+	 */
+	void setCellExtraction(CellExtraction cellExtraction) { _cellExtraction = cellExtraction; }
+
 	/**
 	 * Extract cells from the given cell label image and find all alternative 
 	 * labels for them.
@@ -40,6 +82,38 @@ public:
 			const ImageStack& gtLabels,
 			const ImageStack& recLabels);
 
+	/**
+	 * Update cells that were extracted with extractCells() or updateCells() 
+	 * after the reconstruction changed inside a box. Only the cells close to 
+	 * the box are extracted again and searched for alternative labels (see 
+	 * growChangedBox()), all other cells are taken from the previous cells. 
+	 * The cells are in the same order as the ones of extractCells().
+	 *
+	 * @param previousCells
+	 *             The cells of the previous reconstruction.
+	 * @param gtLabels
+	 *             The ground truth the previous cells were extracted with.
+	 * @param previousRecLabels
+	 *             The previous reconstruction.
+	 * @param recLabels
+	 *             The changed reconstruction.
+	 * @param changedBegin, changedEnd
+	 *             The box [changedBegin, changedEnd) that contains all 
+	 *             locations where the reconstruction changed.
+	 * @param previousCellIndices
+	 *             Set to the index of the previous cell of each cell with the 
+	 *             same seed location, ground truth and reconstruction label, 
+	 *             and size, or Cells::NoCell.
+	 */
+	std::shared_ptr<Cells> updateCells(
+			const Cells& previousCells,
+			const ImageStack& gtLabels,
+			const ImageStack& previousRecLabels,
+			const ImageStack& recLabels,
+			const vigra::Shape3& changedBegin,
+			const vigra::Shape3& changedEnd,
+			std::vector<unsigned int>& previousCellIndices);
+
 protected:
 
 	/**
@@ -49,6 +123,106 @@ protected:
 			std::shared_ptr<Cells> cells,
 			const ImageStack& gtLabels,
 			const ImageStack& recLabels) = 0;
+
+	/**
+	 * Called before cells are extracted. Can be overwritten by subclasses to 
+	 * mark all locations in _nonCandidateLocations that can not be part of a 
+	 * relabel candidate. Cells with such a location are lazy, i.e., their 
+	 * locations are only materialized on demand.
+	 *
+	 * The default leaves _nonCandidateLocations empty, in which case all 
+	 * cells are materialized.
+	 */
+	virtual void findNonCandidateLocations(
+			const ImageStack& /*gtLabels*/,
+			const ImageStack& /*recLabels*/) {}
+
+	/**
+	 * Called before cells are updated. Can be overwritten by subclasses to 
+	 * update _nonCandidateLocations after the reconstruction changed inside 
+	 * the box [changedBegin, changedEnd).
+	 */
+	virtual void updateNonCandidateLocations(
+			const ImageStack& /*gtLabels*/,
+			const ImageStack& /*recLabels*/,
+			const vigra::Shape3& /*changedBegin*/,
+			const vigra::Shape3& /*changedEnd*/) {}
+
+	/**
+	 * Grow the box of changed locations to a box that every cell with changed 
+	 * locations or possible labels intersects. Can be overwritten by 
+	 * subclasses that look further than the direct neighbors of a cell.
+	 *
+	 * The default grows the box by one location, to include cells that touch 
+	 * the changed locations.
+	 */
+	virtual void growChangedBox(vigra::Shape3& begin, vigra::Shape3& end) {
+
+		for (int d = 0; d < 3; d++) {
+
+			begin[d]--;
+			end[d]++;
+		}
+	}
+
+	// the number of threads to use
+	unsigned int _numThreads;
+
+	// locations that can not be part of a relabel candidate, empty if unknown
+	vigra::MultiArray<3, bool> _nonCandidateLocations;
+
+private:
+
+	// the connected components found in a slab of sections
+	struct Slab {
+
+		// the sections [zBegin, zEnd) of this slab
+		unsigned int zBegin;
+		unsigned int zEnd;
+
+		// equivalences between provisional component ids
+		UnionFind<unsigned int> components;
+
+		// the location runs (only if all cells are materialized), labels, 
+		// size, and first location of each provisional component
+		std::vector<std::vector<Cell<size_t>::Run>> contents;
+		std::vector<std::pair<size_t, size_t>>      labels;
+		std::vector<unsigned int>                   sizes;
+		std::vector<Cell<size_t>::Location>         seeds;
+
+		// whether a provisional component contains a non-candidate location
+		std::vector<char> nonCandidate;
+
+		// the provisional ids in the first and last section of the slab
+		std::vector<unsigned int> firstIds;
+		std::vector<unsigned int> lastIds;
+	};
+
+	std::shared_ptr<Cells> extractCellsVigra(
+			const ImageStack& gtLabels,
+			const ImageStack& recLabels);
+
+	std::shared_ptr<Cells> extractCellsFused(
+			const ImageStack& gtLabels,
+			const ImageStack& recLabels,
+			unsigned int numSlabs);
+
+	// flood fill all cells that have a location in the box [begin, end), in 
+	// the order of their seeds
+	std::vector<std::vector<Cell<size_t>::Run>> floodFillBox(
+			const ImageStack& gtLabels,
+			const ImageStack& recLabels,
+			const vigra::Shape3& begin,
+			const vigra::Shape3& end);
+
+	// find the connected components in one slab, returns false if the labels 
+	// can not be packed into keys
+	bool labelSlab(
+			const ImageStack& gtLabels,
+			const ImageStack& recLabels,
+			Slab& slab);
+
+	CellExtraction _cellExtraction;
 };
 
 #endif // TED_EVALUATION_LOCAL_TOLERANCE_FUNCTION_H__
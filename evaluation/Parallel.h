@@ -0,0 +1,85 @@
+#ifndef TED_EVALUATION_PARALLEL_H__
+#define TED_EVALUATION_PARALLEL_H__
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Get the number of worker threads to use for the given requested number of
+ * threads. 0 means to use all available hardware threads.
+ */
+inline unsigned int
+getNumWorkerThreads(unsigned int numThreads) {
+
+	if (numThreads == 0)
+		numThreads = std::thread::hardware_concurrency();
+
+	return std::max(numThreads, 1u);
+}
+
+/**
+ * Call f(i) for every i in [0, n) on a pool of up to numThreads threads (0 for
+ * all hardware threads). Items are handed out to idle threads one at a time
+ * in increasing order, such that items of very different cost are balanced
+ * automatically -- put the expensive items first for best results.
+ *
+ * If any call to f throws, the remaining items are skipped and the first
+ * exception is rethrown in the calling thread.
+ */
+template <typename F>
+void
+parallelFor(size_t n, unsigned int numThreads, F f) {
+
+	numThreads = std::min((size_t)getNumWorkerThreads(numThreads), n);
+
+	if (numThreads <= 1) {
+
+		for (size_t i = 0; i < n; i++)
+			f(i);
+		return;
+	}
+
+	std::atomic<size_t> next(0);
+	std::atomic<bool>   failed(false);
+	std::exception_ptr  exception;
+	std::mutex          exceptionMutex;
+
+	auto worker = [&]() {
+
+		size_t i;
+		while (!failed && (i = next++) < n) {
+
+			try {
+
+				f(i);
+
+			} catch (...) {
+
+				std::lock_guard<std::mutex> lock(exceptionMutex);
+				if (!failed)
+					exception = std::current_exception();
+				failed = true;
+			}
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (unsigned int t = 1; t < numThreads; t++)
+		threads.push_back(std::thread(worker));
+
+	// the calling thread takes part in the work
+	worker();
+
+	for (std::thread& thread : threads)
+		thread.join();
+
+	if (exception)
+		std::rethrow_exception(exception);
+}
+
+#endif // TED_EVALUATION_PARALLEL_H__
+
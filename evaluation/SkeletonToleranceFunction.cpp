@@ -3,6 +3,60 @@
 
 logger::LogChannel skeletontolerancelog("skeletontolerancelog", "[SkeletonToleranceFunction] ");
 
+void
+SkeletonToleranceFunction::findNonCandidateLocations(
+		const ImageStack& gtLabels,
+		const ImageStack& recLabels) {
+
+	initialize(gtLabels, recLabels);
+
+	findNonSkeletonLocations(gtLabels);
+
+	_nonCandidateLocations = _nonSkeletonLocations;
+}
+
+void
+SkeletonToleranceFunction::updateNonCandidateLocations(
+		const ImageStack& /*gtLabels*/,
+		const ImageStack& recLabels,
+		const vigra::Shape3& changedBegin,
+		const vigra::Shape3& changedEnd) {
+
+	updateBoundaryMap(recLabels, changedBegin, changedEnd);
+}
+
+void
+SkeletonToleranceFunction::findNonSkeletonLocations(const ImageStack& gtLabels) {
+
+	// The skeletons do not depend on the reconstruction. When the same ground 
+	// truth sections are evaluated against several reconstructions, they are 
+	// only scanned once. This assumes that sections are not modified in 
+	// place.
+
+	std::vector<std::shared_ptr<const Image>> sections;
+	for (unsigned int z = 0; z < gtLabels.size(); z++)
+		sections.push_back(gtLabels[z]);
+
+	if (sections == _nonSkeletonSections) {
+
+		LOG_DEBUG(skeletontolerancelog) << "reusing skeleton locations" << std::endl;
+		return;
+	}
+
+	_nonSkeletonLocations.reshape(vigra::Shape3(gtLabels.width(), gtLabels.height(), gtLabels.size()));
+
+	for (unsigned int z = 0; z < gtLabels.size(); z++) {
+
+		std::shared_ptr<const Image> gt = gtLabels[z];
+
+		for (unsigned int y = 0; y < gtLabels.height(); y++)
+			for (unsigned int x = 0; x < gtLabels.width(); x++)
+				_nonSkeletonLocations(x, y, z) = ((size_t)(*gt)(x, y) == _gtBackgroundLabel);
+	}
+
+	_nonSkeletonSections.swap(sections);
+}
+
 void
 SkeletonToleranceFunction::initializeCellLabels(std::shared_ptr<Cells> cells) {
 
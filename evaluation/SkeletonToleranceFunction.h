@@ -14,15 +14,35 @@ public:
 
 	SkeletonToleranceFunction(
 			float distanceThreshold,
-			size_t gtBackgroundLabel) :
+			size_t gtBackgroundLabel,
+			AlternativeLabelSearch alternativeLabelSearch = NeighborhoodScan) :
 		DistanceToleranceFunction(
 				distanceThreshold,
-				false), /* don't allow background appearance */
+				false, /* don't allow background appearance */
+				0,
+				alternativeLabelSearch),
 		_gtBackgroundLabel(gtBackgroundLabel),
 		_ignoreLabel((size_t)(-1)) {}
 
 private:
 
+	// only skeleton cells can be relabeled, mark all non-skeleton locations
+	virtual void findNonCandidateLocations(
+			const ImageStack& gtLabels,
+			const ImageStack& recLabels) override;
+
+	// the skeletons do not change with the reconstruction, only update the 
+	// boundaries
+	virtual void updateNonCandidateLocations(
+			const ImageStack& gtLabels,
+			const ImageStack& recLabels,
+			const vigra::Shape3& changedBegin,
+			const vigra::Shape3& changedEnd) override;
+
+	// find the non-skeleton locations of the given ground truth, unless they 
+	// are known already from a previous call with the same sections
+	void findNonSkeletonLocations(const ImageStack& gtLabels);
+
 	virtual void initializeCellLabels(std::shared_ptr<Cells> cells) override;
 
 	// for the skeleton criterion, only skeleton cells are allowed to be 
@@ -36,6 +56,11 @@ private:
 
 	// label used for non-skeleton cells, which should be ignored
 	size_t _ignoreLabel;
+
+	// the non-skeleton locations of the ground truth, and the sections they 
+	// were found in
+	vigra::MultiArray<3, bool> _nonSkeletonLocations;
+	std::vector<std::shared_ptr<const Image>> _nonSkeletonSections;
 };
 
 #endif // TED_EVALUATION_SKELETON_TOLERANCE_FUNCTION_H__
@@ -0,0 +1,91 @@
+#ifndef TED_EVALUATION_SMALL_SET_H__
+#define TED_EVALUATION_SMALL_SET_H__
+
+#include <algorithm>
+#include <vector>
+
+/**
+ * A sorted set of values that stores up to N values inline, and moves them to 
+ * the heap only if more are added. Iterates in increasing order, like a 
+ * std::set.
+ */
+template <typename T, unsigned int N = 2>
+class SmallSet {
+
+public:
+
+	typedef const T* const_iterator;
+	typedef const T* iterator;
+
+	SmallSet() :
+		_size(0) {}
+
+	/**
+	 * Add a value. Returns false, if the value was already contained.
+	 */
+	bool insert(const T& value) {
+
+		T* b = data();
+		T* i = std::lower_bound(b, b + _size, value);
+
+		if (i != b + _size && *i == value)
+			return false;
+
+		size_t pos = i - b;
+
+		if (_size < N) {
+
+			std::copy_backward(_inline + pos, _inline + _size, _inline + _size + 1);
+			_inline[pos] = value;
+
+		} else {
+
+			if (_size == N)
+				_heap.assign(_inline, _inline + N);
+
+			_heap.insert(_heap.begin() + pos, value);
+		}
+
+		_size++;
+
+		return true;
+	}
+
+	/**
+	 * Get the number of occurences of a value, i.e., 0 or 1.
+	 */
+	size_t count(const T& value) const {
+
+		return std::binary_search(begin(), end(), value) ? 1 : 0;
+	}
+
+	/**
+	 * Remove all values.
+	 */
+	void clear() {
+
+		_size = 0;
+		_heap.clear();
+	}
+
+	size_t size() const { return _size; }
+
+	bool empty() const { return _size == 0; }
+
+	const_iterator begin() const { return data(); }
+	const_iterator end() const { return data() + _size; }
+
+private:
+
+	T* data() { return (_size <= N ? _inline : _heap.data()); }
+	const T* data() const { return (_size <= N ? _inline : _heap.data()); }
+
+	size_t _size;
+
+	T _inline[N];
+
+	std::vector<T> _heap;
+};
+
+#endif // TED_EVALUATION_SMALL_SET_H__
+
@@ -0,0 +1,28 @@
+#include <inference/LinearConstraints.h>
+#include <inference/SolverFactory.h>
+#include "BranchAndBoundSolver.h"
+#include "SolverBackend.h"
+
+std::unique_ptr<LinearSolverBackend>
+createSolverBackend(SolverBackend solverBackend) {
+
+	if (solverBackend == BranchAndBound)
+		return std::unique_ptr<LinearSolverBackend>(new BranchAndBoundSolver());
+
+	SolverFactory factory;
+	return std::unique_ptr<LinearSolverBackend>(factory.createLinearSolverBackend());
+}
+
+void
+setConstraints(LinearSolverBackend& solver, const SparseConstraints& constraints) {
+
+	if (BranchAndBoundSolver* branchAndBound = dynamic_cast<BranchAndBoundSolver*>(&solver)) {
+
+		branchAndBound->setConstraints(constraints);
+		return;
+	}
+
+	solver.setConstraints(LinearConstraints());
+	for (unsigned int row = 0; row < constraints.size(); row++)
+		solver.addConstraint(constraints.getConstraint(row));
+}
@@ -0,0 +1,40 @@
+#ifndef TED_EVALUATION_SOLVER_BACKEND_H__
+#define TED_EVALUATION_SOLVER_BACKEND_H__
+
+#include <memory>
+
+#include <inference/LinearSolverBackend.h>
+#include "SparseConstraints.h"
+
+/**
+ * The linear solver backends to solve the ILPs of TED and detection overlap 
+ * with.
+ */
+enum SolverBackend {
+
+	/**
+	 * The best backend available through SolverFactory (e.g., Gurobi).
+	 */
+	ExternalSolver,
+
+	/**
+	 * The in-tree BranchAndBoundSolver, which does not need an external solver 
+	 * library or license.
+	 */
+	BranchAndBound
+};
+
+/**
+ * Create a linear solver backend of the given type.
+ */
+std::unique_ptr<LinearSolverBackend> createSolverBackend(SolverBackend solverBackend);
+
+/**
+ * Set the constraints of a linear solver backend from a sparse matrix. The 
+ * in-tree BranchAndBoundSolver reads the matrix directly, other backends get 
+ * the rows one by one through addConstraint().
+ */
+void setConstraints(LinearSolverBackend& solver, const SparseConstraints& constraints);
+
+#endif // TED_EVALUATION_SOLVER_BACKEND_H__
+
@@ -0,0 +1,45 @@
+#include "SparseConstraints.h"
+
+void
+SparseConstraints::reserve(size_t numRows, size_t numNonZeros) {
+
+	_rowBegins.reserve(numRows + 1);
+	_relations.reserve(numRows);
+	_rhs.reserve(numRows);
+	_columns.reserve(numNonZeros);
+	_values.reserve(numNonZeros);
+}
+
+unsigned int
+SparseConstraints::addRow(Relation relation, double rhs) {
+
+	_rowBegins.push_back(_columns.size());
+	_relations.push_back(relation);
+	_rhs.push_back(rhs);
+
+	return _relations.size() - 1;
+}
+
+void
+SparseConstraints::clear() {
+
+	_rowBegins.assign(1, 0);
+	_columns.clear();
+	_values.clear();
+	_relations.clear();
+	_rhs.clear();
+}
+
+LinearConstraint
+SparseConstraints::getConstraint(unsigned int row) const {
+
+	LinearConstraint constraint;
+
+	for (unsigned int k = getRowBegin(row); k < getRowEnd(row); k++)
+		constraint.setCoefficient(_columns[k], _values[k]);
+	constraint.setRelation(_relations[row]);
+	constraint.setValue(_rhs[row]);
+
+	return constraint;
+}
+
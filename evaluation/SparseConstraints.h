@@ -0,0 +1,84 @@
+#ifndef TED_EVALUATION_SPARSE_CONSTRAINTS_H__
+#define TED_EVALUATION_SPARSE_CONSTRAINTS_H__
+
+#include <vector>
+
+#include <inference/LinearConstraints.h>
+#include <inference/Relation.h>
+
+/**
+ * A set of linear constraints in compressed sparse row format, to be filled 
+ * in bulk without creating an object per constraint. Row r is
+ *
+ *   sum_k getValues()[k]*x_{getColumns()[k]}  <getRelation(r)>  getRhs(r)
+ *
+ * for k in [getRowBegin(r), getRowEnd(r)).
+ */
+class SparseConstraints {
+
+public:
+
+	SparseConstraints() : _rowBegins(1, 0) {}
+
+	/**
+	 * Reserve memory for the given number of rows and non-zero coefficients.
+	 */
+	void reserve(size_t numRows, size_t numNonZeros);
+
+	/**
+	 * Start a new row. Subsequent calls to addCoefficient() add to this row.
+	 *
+	 * @return The index of the new row.
+	 */
+	unsigned int addRow(Relation relation, double rhs);
+
+	/**
+	 * Add a coefficient to the last row. Every variable should appear at 
+	 * most once per row.
+	 */
+	void addCoefficient(unsigned int var, double value) {
+
+		_columns.push_back(var);
+		_values.push_back(value);
+		_rowBegins.back() = _columns.size();
+	}
+
+	/**
+	 * Change the right hand side of a row.
+	 */
+	void setRhs(unsigned int row, double rhs) { _rhs[row] = rhs; }
+
+	/**
+	 * Remove all rows.
+	 */
+	void clear();
+
+	unsigned int size() const { return _relations.size(); }
+
+	size_t getNumNonZeros() const { return _columns.size(); }
+
+	unsigned int getRowBegin(unsigned int row) const { return _rowBegins[row]; }
+	unsigned int getRowEnd(unsigned int row) const { return _rowBegins[row + 1]; }
+
+	const std::vector<unsigned int>& getColumns() const { return _columns; }
+	const std::vector<double>& getValues() const { return _values; }
+
+	Relation getRelation(unsigned int row) const { return _relations[row]; }
+	double getRhs(unsigned int row) const { return _rhs[row]; }
+
+	/**
+	 * Get a single row as a LinearConstraint, for backends that need them.
+	 */
+	LinearConstraint getConstraint(unsigned int row) const;
+
+private:
+
+	std::vector<unsigned int> _rowBegins;
+	std::vector<unsigned int> _columns;
+	std::vector<double>       _values;
+	std::vector<Relation>     _relations;
+	std::vector<double>       _rhs;
+};
+
+#endif // TED_EVALUATION_SPARSE_CONSTRAINTS_H__
+
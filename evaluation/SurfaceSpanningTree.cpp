@@ -0,0 +1,157 @@
+#include <algorithm>
+
+#include "SurfaceSpanningTree.h"
+#include "UnionFind.h"
+
+SurfaceSpanningTree::SurfaceSpanningTree(const std::vector<CellSurface>& surfaces) {
+
+	unsigned int numSets = surfaces.size();
+
+	for (unsigned int i = 0; i < numSets; i++)
+		for (const CellSurface::Point& location : surfaces[i]._points) {
+
+			Point p;
+			p.x = location.x;
+			p.y = location.y;
+			p.z = location.z;
+			p.set = i;
+
+			_points.push_back(p);
+		}
+
+	build(0, _points.size(), 0);
+
+	_subtreeComponents.resize(_points.size());
+
+	UnionFind<unsigned int> sets(numSets);
+	unsigned int numComponents = numSets;
+
+	// In each round, connect each component to its closest other component. 
+	// Since all edges are distinct, these edges are all in the minimum 
+	// spanning tree, and at least halve the number of components.
+	while (numComponents > 1) {
+
+		std::vector<unsigned int> components(numSets);
+		for (unsigned int i = 0; i < numSets; i++)
+			components[i] = sets.find(i);
+
+		labelSubtrees(0, _points.size(), components);
+
+		std::vector<Edge> shortest(numSets);
+		for (const Point& p : _points) {
+
+			unsigned int component = components[p.set];
+			findNearest(p, component, 0, _points.size(), 0, components, shortest[component]);
+		}
+
+		for (unsigned int component = 0; component < numSets; component++) {
+
+			if (components[component] != component)
+				continue;
+
+			const Edge& edge = shortest[component];
+
+			// the same edge might be the shortest for both of its components
+			if (sets.find(edge.a) == sets.find(edge.b))
+				continue;
+
+			sets.merge(edge.a, edge.b);
+			_edges.push_back(std::make_pair(edge.a, edge.b));
+			numComponents--;
+		}
+	}
+}
+
+void
+SurfaceSpanningTree::build(size_t begin, size_t end, int depth) {
+
+	if (end - begin < 2)
+		return;
+
+	int    axis = depth%3;
+	size_t mid  = begin + (end - begin)/2;
+
+	std::nth_element(
+			_points.begin() + begin,
+			_points.begin() + mid,
+			_points.begin() + end,
+			[axis](const Point& a, const Point& b) { return coordinate(a, axis) < coordinate(b, axis); });
+
+	build(begin, mid, depth + 1);
+	build(mid + 1, end, depth + 1);
+}
+
+unsigned int
+SurfaceSpanningTree::labelSubtrees(
+		size_t begin,
+		size_t end,
+		const std::vector<unsigned int>& components) {
+
+	if (begin >= end)
+		return Empty;
+
+	size_t mid = begin + (end - begin)/2;
+
+	unsigned int component = components[_points[mid].set];
+	unsigned int left      = labelSubtrees(begin, mid, components);
+	unsigned int right     = labelSubtrees(mid + 1, end, components);
+
+	if ((left != Empty && left != component) || (right != Empty && right != component))
+		component = Mixed;
+
+	_subtreeComponents[mid] = component;
+
+	return component;
+}
+
+void
+SurfaceSpanningTree::findNearest(
+		const Point& p,
+		unsigned int component,
+		size_t begin,
+		size_t end,
+		int depth,
+		const std::vector<unsigned int>& components,
+		Edge& best) const {
+
+	if (begin >= end)
+		return;
+
+	size_t mid = begin + (end - begin)/2;
+
+	// nothing to find in subtrees of the own component
+	if (_subtreeComponents[mid] == component)
+		return;
+
+	int axis = depth%3;
+
+	const Point& node = _points[mid];
+
+	if (components[node.set] != component) {
+
+		long long dx = p.x - node.x;
+		long long dy = p.y - node.y;
+		long long dz = p.z - node.z;
+
+		Edge edge(dx*dx + dy*dy + dz*dz, p.set, node.set);
+		if (edge < best)
+			best = edge;
+	}
+
+	long long d = coordinate(p, axis) - coordinate(node, axis);
+
+	// visit the side of p first, the other side only if it can contain an 
+	// edge as short as the best one (which might win by its set indices)
+	if (d < 0) {
+
+		findNearest(p, component, begin, mid, depth + 1, components, best);
+		if (d*d <= best.distance2)
+			findNearest(p, component, mid + 1, end, depth + 1, components, best);
+
+	} else {
+
+		findNearest(p, component, mid + 1, end, depth + 1, components, best);
+		if (d*d <= best.distance2)
+			findNearest(p, component, begin, mid, depth + 1, components, best);
+	}
+}
@@ -0,0 +1,111 @@
+#ifndef TED_EVALUATION_SURFACE_SPANNING_TREE_H__
+#define TED_EVALUATION_SURFACE_SPANNING_TREE_H__
+
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "CellSurface.h"
+
+/**
+ * The minimum spanning tree of several disjoint sets of cells, in which two 
+ * sets are connected by the distance of their closest locations. Found with 
+ * Boruvka's algorithm on one k-d tree over the surfaces of all sets, such that 
+ * no distances between all pairs of sets are needed.
+ */
+class SurfaceSpanningTree {
+
+public:
+
+	/**
+	 * Find the minimum spanning tree of the sets with the given surfaces.
+	 */
+	SurfaceSpanningTree(const std::vector<CellSurface>& surfaces);
+
+	/**
+	 * Get the edges of the tree, as pairs of indices into the surfaces, the 
+	 * smaller index first.
+	 */
+	const std::vector<std::pair<unsigned int, unsigned int>>& getEdges() const { return _edges; }
+
+private:
+
+	enum : unsigned int {
+
+		// the subtree contains locations of several components
+		Mixed = std::numeric_limits<unsigned int>::max(),
+
+		// the subtree is empty
+		Empty = std::numeric_limits<unsigned int>::max() - 1
+	};
+
+	struct Point {
+
+		int x, y, z;
+
+		// the index of the set of this location
+		unsigned int set;
+	};
+
+	// a candidate edge, ordered by distance and then by the indices of its 
+	// sets, such that all edges are distinct
+	struct Edge {
+
+		Edge() :
+			distance2(std::numeric_limits<long long>::max()),
+			a(0),
+			b(0) {}
+
+		Edge(long long d2, unsigned int s, unsigned int t) :
+			distance2(d2),
+			a(std::min(s, t)),
+			b(std::max(s, t)) {}
+
+		bool operator<(const Edge& other) const {
+
+			if (distance2 != other.distance2)
+				return distance2 < other.distance2;
+			if (a != other.a)
+				return a < other.a;
+			return b < other.b;
+		}
+
+		long long distance2;
+		unsigned int a, b;
+	};
+
+	static int coordinate(const Point& p, int axis) {
+
+		return (axis == 0 ? p.x : (axis == 1 ? p.y : p.z));
+	}
+
+	// sort the points in [begin, end) into a k-d tree, as in CellSurface
+	void build(size_t begin, size_t end, int depth);
+
+	// find the component of each subtree, given the component of each set
+	unsigned int labelSubtrees(
+			size_t begin,
+			size_t end,
+			const std::vector<unsigned int>& components);
+
+	// lower best to the shortest edge from p to a location in [begin, end) 
+	// of another component
+	void findNearest(
+			const Point& p,
+			unsigned int component,
+			size_t begin,
+			size_t end,
+			int depth,
+			const std::vector<unsigned int>& components,
+			Edge& best) const;
+
+	std::vector<Point> _points;
+
+	// the component of the subtree with each point as median, or Mixed
+	std::vector<unsigned int> _subtreeComponents;
+
+	std::vector<std::pair<unsigned int, unsigned int>> _edges;
+};
+
+#endif // TED_EVALUATION_SURFACE_SPANNING_TREE_H__
+
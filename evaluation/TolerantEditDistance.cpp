@@ -1,341 +1,606 @@
 #include <algorithm>
+#include <chrono>
 
-#include <inference/LinearConstraints.h>
-#include <inference/LinearObjective.h>
-#include <inference/LinearSolverBackend.h>
-#include <inference/SolverFactory.h>
 #include <inference/Solution.h>
 #include <util/exceptions.h>
 #include <util/Logger.h>
 #include "TolerantEditDistance.h"
 #include "DistanceToleranceFunction.h"
 #include "SkeletonToleranceFunction.h"
+#include "TolerantEditDistanceComponent.h"
+#include "UnionFind.h"
+#include "Parallel.h"
 #include "Cells.h"
+#include "DenseLabels.h"
 
 logger::LogChannel tedlog("tedlog", "[TolerantEditDistance] ");
 
 TolerantEditDistance::TolerantEditDistance(const Parameters& parameters) :
-	_parameters(parameters) {
+	_parameters(parameters),
+	_haveGroundTruth(false) {
 
 	if (_parameters.fromSkeleton){
 
-		_toleranceFunction = std::unique_ptr<LocalToleranceFunction>(
+		_toleranceFunction = std::unique_ptr<DistanceToleranceFunction>(
 				new SkeletonToleranceFunction(
 						_parameters.distanceThreshold,
-						_parameters.gtBackgroundLabel));
+						_parameters.gtBackgroundLabel,
+						_parameters.alternativeLabelSearch));
 
 		LOG_ALL(tedlog) << "created TolerantEditDistance for skeleton ground-truth" << std::endl;
 
 	} else {
 
-		_toleranceFunction = std::unique_ptr<LocalToleranceFunction>(
+		_toleranceFunction = std::unique_ptr<DistanceToleranceFunction>(
 				new DistanceToleranceFunction(
 						_parameters.distanceThreshold,
 						_parameters.allowBackgroundAppearance,
-						_parameters.recBackgroundLabel));
+						_parameters.recBackgroundLabel,
+						_parameters.alternativeLabelSearch));
 
 		LOG_ALL(tedlog) << "created TolerantEditDistance for volumetric ground-truth" << std::endl;
 	}
+
+	_toleranceFunction->setNumThreads(_parameters.numThreads);
+	_toleranceFunction->setCellExtraction(_parameters.cellExtraction);
 }
 
 TolerantEditDistanceErrors
 TolerantEditDistance::compute(const ImageStack& groundTruth, const ImageStack& reconstruction) {
 
-	reset(groundTruth, reconstruction);
+	setGroundTruth(groundTruth);
+
+	return compute(reconstruction);
+}
+
+void
+TolerantEditDistance::setGroundTruth(const ImageStack& groundTruth) {
+
+	// the stack only holds pointers to its sections, the tolerance function 
+	// recognizes them in the following calls and reuses what it derived from 
+	// them
+	_groundTruth = groundTruth;
+	_haveGroundTruth = true;
+
+	// previous results are for a different ground truth
+	_cells.reset();
+
+	_depth  = groundTruth.size();
+	_width  = groundTruth.width();
+	_height = groundTruth.height();
+}
+
+TolerantEditDistanceErrors
+TolerantEditDistance::compute(const ImageStack& reconstruction) {
+
+	reset(reconstruction);
 
-	std::shared_ptr<Cells> cells = _toleranceFunction->extractCells(groundTruth, reconstruction);
+	_toleranceFunction->setDistanceThreshold(_parameters.distanceThreshold);
+
+	std::shared_ptr<Cells> cells = _toleranceFunction->extractCells(_groundTruth, reconstruction);
 
 	minimizeErrors(*cells);
 
-	correctReconstruction(*cells);
+	correctReconstruction(*cells, reconstruction);
+
+	// keep the cells for the next update()
+	_cells = cells;
+	_reconstruction = reconstruction;
 
 	return findErrors(cells);
 }
 
+TolerantEditDistanceErrors
+TolerantEditDistance::update(const ImageStack& reconstruction, const std::vector<size_t>& changedLabels) {
+
+	if (!_cells)
+		return compute(reconstruction);
+
+	// check the size before looking at the reconstruction
+	reset(reconstruction);
+
+	std::vector<size_t> labels = changedLabels;
+	std::sort(labels.begin(), labels.end());
+
+	// the bounding box of the changed labels, before and after the change, 
+	// in the sections that are not shared with the previous reconstruction
+
+	vigra::Shape3 begin(_width, _height, _depth);
+	vigra::Shape3 end(0, 0, 0);
+
+	for (const ImageStack* stack : std::vector<const ImageStack*>{ &_reconstruction, &reconstruction }) {
+
+		for (unsigned int z = 0; z < _depth; z++) {
+
+			if (reconstruction[z] == _reconstruction[z])
+				continue;
+
+			const Image& section = *(*stack)[z];
+
+			for (unsigned int y = 0; y < _height; y++)
+				for (unsigned int x = 0; x < _width; x++)
+					if (std::binary_search(labels.begin(), labels.end(), (size_t)section(x, y))) {
+
+						begin[0] = std::min(begin[0], (std::ptrdiff_t)x);
+						begin[1] = std::min(begin[1], (std::ptrdiff_t)y);
+						begin[2] = std::min(begin[2], (std::ptrdiff_t)z);
+						end[0]   = std::max(end[0],   (std::ptrdiff_t)x + 1);
+						end[1]   = std::max(end[1],   (std::ptrdiff_t)y + 1);
+						end[2]   = std::max(end[2],   (std::ptrdiff_t)z + 1);
+					}
+		}
+	}
+
+	return update(reconstruction, begin, end);
+}
+
+TolerantEditDistanceErrors
+TolerantEditDistance::update(
+		const ImageStack& reconstruction,
+		const vigra::Shape3& changedBegin,
+		const vigra::Shape3& changedEnd) {
+
+	if (!_cells)
+		return compute(reconstruction);
+
+	reset(reconstruction);
+
+	LOG_DEBUG(tedlog)
+			<< "updating errors for changes in " << changedBegin
+			<< " to " << changedEnd << std::endl;
+
+	// extract only the cells close to the change again, and search 
+	// alternative labels only for them
+
+	_toleranceFunction->setDistanceThreshold(_parameters.distanceThreshold);
+
+	std::vector<unsigned int> previousCells;
+	std::shared_ptr<Cells> cells = _toleranceFunction->updateCells(
+			*_cells,
+			_groundTruth,
+			_reconstruction,
+			reconstruction,
+			changedBegin,
+			changedEnd,
+			previousCells);
+
+	// find the cells that enter the ILP the same way as before
+
+	for (unsigned int cellIndex = 0; cellIndex < cells->size(); cellIndex++) {
+
+		if (previousCells[cellIndex] == Cells::NoCell)
+			continue;
+
+		const SmallSet<size_t>& possibleLabels = (*cells)[cellIndex].getPossibleLabels();
+		const SmallSet<size_t>& previousLabels = (*_cells)[previousCells[cellIndex]].getPossibleLabels();
+
+		if (possibleLabels.size() != previousLabels.size() ||
+		    !std::equal(possibleLabels.begin(), possibleLabels.end(), previousLabels.begin()))
+			previousCells[cellIndex] = Cells::NoCell;
+	}
+
+	// the component and position in it of each previous cell
+
+	_previousComponents.assign(_cells->size(), std::make_pair((unsigned int)Cells::NoCell, 0u));
+	for (unsigned int i = 0; i < _componentResults.size(); i++)
+		for (unsigned int j = 0; j < _componentResults[i].cellIndices.size(); j++)
+			_previousComponents[_componentResults[i].cellIndices[j]] = std::make_pair(i, j);
+
+	minimizeErrors(*cells, previousCells);
+
+	_previousComponents.clear();
+
+	correctReconstruction(*cells, reconstruction);
+
+	_cells = cells;
+	_reconstruction = reconstruction;
+
+	return findErrors(cells);
+}
+
+std::vector<TolerantEditDistanceErrors>
+TolerantEditDistance::compute(const ImageStack& reconstruction, const std::vector<unsigned int>& distanceThresholds) {
+
+	if (distanceThresholds.empty() || !std::is_sorted(distanceThresholds.begin(), distanceThresholds.end()))
+		UTIL_THROW_EXCEPTION(UsageError, "distance thresholds have to be given in increasing order");
+
+	reset(reconstruction);
+
+	// extract the cells and their possible labels once, for the largest 
+	// threshold
+
+	_toleranceFunction->setDistanceThreshold(distanceThresholds.back());
+
+	std::shared_ptr<Cells> cells = _toleranceFunction->extractCells(_groundTruth, reconstruction);
+
+	// the possible labels for smaller thresholds are the ones that are close 
+	// enough
+
+	std::vector<std::vector<float>> labelDistances = _toleranceFunction->getPossibleLabelDistances(*cells, reconstruction);
+
+	std::vector<std::vector<size_t>> possibleLabels(cells->size());
+	for (unsigned int cellIndex = 0; cellIndex < cells->size(); cellIndex++)
+		possibleLabels[cellIndex].assign(
+				(*cells)[cellIndex].getPossibleLabels().begin(),
+				(*cells)[cellIndex].getPossibleLabels().end());
+
+	std::vector<TolerantEditDistanceErrors> errors;
+
+	for (unsigned int threshold : distanceThresholds) {
+
+		LOG_DEBUG(tedlog) << "computing errors for distance threshold " << threshold << std::endl;
+
+		float threshold2 = static_cast<float>(threshold)*threshold;
+
+		for (unsigned int cellIndex = 0; cellIndex < cells->size(); cellIndex++) {
+
+			Cell<size_t>& cell = (*cells)[cellIndex];
+
+			cell.clearPossibleLabels();
+			for (unsigned int i = 0; i < possibleLabels[cellIndex].size(); i++)
+				if (labelDistances[cellIndex][i] <= threshold2)
+					cell.addPossibleLabel(possibleLabels[cellIndex][i]);
+		}
+
+		resetSolution();
+
+		minimizeErrors(*cells);
+
+		errors.push_back(findErrors(cells));
+
+		// The solution stays feasible for the next threshold, since the 
+		// possible labels only grow. Start the next search from it.
+		_startLabels.assign(cells->size(), 0);
+		for (unsigned int i = 0; i < _numIndicatorVars; i++)
+			if (_solution[i])
+				_startLabels[_labelingByVar[i].first] = _labelingByVar[i].second;
+	}
+
+	_startLabels.clear();
+
+	correctReconstruction(*cells, reconstruction);
+
+	// the cells were not extracted for the distance threshold of the 
+	// parameters, the next update() has to start over
+	_cells.reset();
+
+	return errors;
+}
+
 void
-TolerantEditDistance::reset(const ImageStack& groundTruth, const ImageStack& reconstruction) {
+TolerantEditDistance::reset(const ImageStack& reconstruction) {
+
+	if (!_haveGroundTruth)
+		UTIL_THROW_EXCEPTION(UsageError, "no ground truth set, call setGroundTruth() first");
 
-	if (groundTruth.size() != reconstruction.size())
+	if (_depth != reconstruction.size())
 		BOOST_THROW_EXCEPTION(SizeMismatchError() << error_message("ground truth and reconstruction have different size") << STACK_TRACE);
 
-	if (groundTruth.height() != reconstruction.height() || groundTruth.width() != reconstruction.width())
+	if (_height != reconstruction.height() || _width != reconstruction.width())
 		BOOST_THROW_EXCEPTION(SizeMismatchError() << error_message("ground truth and reconstruction have different size") << STACK_TRACE);
 
-	_depth  = groundTruth.size();
-	_width  = groundTruth.width();
-	_height = groundTruth.height();
+	_correctedReconstruction.clear();
+
+	resetSolution();
+}
+
+void
+TolerantEditDistance::resetSolution() {
 
-	_indicatorVarsByRecLabel.clear();
-	_indicatorVarsByGtToRecLabel.clear();
-	_matchVars.clear();
 	_labelingByVar.clear();
-	_alternativeIndicators.clear();
-	_correctedReconstruction.clear();
+	_firstIndicatorVar.clear();
 	_splitLocations.clear();
 	_mergeLocations.clear();
 	_fpLocations.clear();
 	_fnLocations.clear();
+	_splitRuns.clear();
+	_mergeRuns.clear();
+	_fpRuns.clear();
+	_fnRuns.clear();
 }
 
 void
-TolerantEditDistance::minimizeErrors(const Cells& cells) {
+TolerantEditDistance::minimizeErrors(const Cells& cells, const std::vector<unsigned int>& previousCells) {
+
+	// enumerate the indicator variables for each cell and each possible label 
+	// of that cell
+
+	unsigned int var = 0;
+	for (unsigned int cellIndex = 0; cellIndex < cells.size(); cellIndex++) {
 
-	std::set<size_t> reconstructionLabels;
-	std::set<size_t> groundTruthLabels;
-	std::map<size_t, std::set<size_t>> possibleMatchesByGt;
-	std::map<size_t, std::set<size_t>> possibleMatchesByRec;
+		const Cell<size_t>& cell = cells[cellIndex];
 
-	for (const auto& cell : cells) {
+		if (cell.getPossibleLabels().size() == 0)
+			UTIL_THROW_EXCEPTION(Exception, "cell " << cellIndex << " has no possible labels");
 
-		reconstructionLabels.insert(cell.getReconstructionLabel());
-		groundTruthLabels.insert(cell.getGroundTruthLabel());
+		_firstIndicatorVar.push_back(var);
 
 		for (size_t l : cell.getPossibleLabels()) {
 
-			possibleMatchesByGt[cell.getGroundTruthLabel()].insert(l);
-			possibleMatchesByRec[l].insert(cell.getGroundTruthLabel());
+			_labelingByVar.push_back(std::make_pair(cellIndex, l));
+			var++;
 		}
 	}
+	_numIndicatorVars = var;
 
-	LOG_DEBUG(tedlog)
-			<< "found "
-			<< groundTruthLabels.size()
-			<< " ground truth labels and "
-			<< reconstructionLabels.size()
-			<< " reconstruction labels"
-			<< std::endl;
+	// solve each independent component separately
 
-	LinearConstraints constraints;
+	std::vector<std::vector<unsigned int>> componentCells = findComponents(cells);
 
-	// the default are binary variables
-	std::map<unsigned int, VariableType> specialVariableTypes;
+	// start with the largest components, to keep all threads busy
+	std::stable_sort(
+			componentCells.begin(),
+			componentCells.end(),
+			[](const std::vector<unsigned int>& a, const std::vector<unsigned int>& b) {
+				return a.size() > b.size();
+			});
 
-	// introduce indicators for each cell and each possible label of that cell
-	unsigned int var = 0;
-	for (unsigned int cellIndex = 0; cellIndex < cells.size(); cellIndex++) {
+	// components that consist of the same cells as a component of the 
+	// previous result have the same ILP, keep their results
 
-		const Cell<size_t>& cell = cells[cellIndex];
+	std::vector<ComponentResult> results(componentCells.size());
+	std::vector<char> reused(componentCells.size(), 0);
 
-		// first indicator variable for this cell
-		unsigned int begin = var;
+	if (!previousCells.empty())
+		for (unsigned int i = 0; i < componentCells.size(); i++)
+			reused[i] = reuseComponentResult(componentCells[i], previousCells, results[i]);
 
-		// one variable for each possible label
-		for (size_t l : cell.getPossibleLabels()) {
+	std::vector<TolerantEditDistanceComponent> components;
+	std::vector<unsigned int> componentResults;
+	for (unsigned int i = 0; i < componentCells.size(); i++) {
 
-			unsigned int ind = var++;
-			assignIndicatorVariable(ind, cellIndex, cell.getGroundTruthLabel(), l);
+		if (reused[i])
+			continue;
 
-			if (l != cell.getReconstructionLabel())
-				_alternativeIndicators.push_back(std::make_pair(ind, cell.size()));
-		}
+		components.push_back(TolerantEditDistanceComponent(cells, componentCells[i]));
+		componentResults.push_back(i);
 
-		// last +1 indicator variable for this cell
-		unsigned int end = var;
+		if (!_startLabels.empty())
+			components.back().setStartLabels(_startLabels);
+	}
 
-		if (begin == end)
-			UTIL_THROW_EXCEPTION(Exception, "cell " << cellIndex << " has no possible labels");
+	LOG_DEBUG(tedlog)
+			<< "solving " << components.size() << " independent components"
+			<< (components.size() > 0 ? " (largest has " + std::to_string(components[0].getCellIndices().size()) + " cells)" : "")
+			<< ", reusing " << componentCells.size() - components.size()
+			<< std::endl;
+
+	// in anytime mode, each component gets a share of the total thread time 
+	// in proportion to its number of ambiguous cells, but not more than is 
+	// left until the deadline
 
-		// every cell needs to have a label
-		LinearConstraint constraint;
-		for (unsigned int i = begin; i < end; i++)
-			constraint.setCoefficient(i, 1.0);
-		constraint.setRelation(Equal);
-		constraint.setValue(1);
-		constraints.add(constraint);
+	std::vector<size_t> numAmbiguousCells(components.size(), 0);
+	size_t totalAmbiguousCells = 0;
+	for (unsigned int i = 0; i < components.size(); i++) {
 
-		//LOG_ALL(tedlog) << constraint << std::endl;
+		for (unsigned int cellIndex : components[i].getCellIndices())
+			if (cells[cellIndex].getPossibleLabels().size() > 1)
+				numAmbiguousCells[i]++;
+		totalAmbiguousCells += numAmbiguousCells[i];
 	}
-	_numIndicatorVars = var;
 
-	// introduce indicators for each match of ground truth label to 
-	// reconstruction label
-	for (size_t gtLabel : groundTruthLabels)
-		for (size_t recLabel : possibleMatchesByGt[gtLabel])
-			assignMatchVariable(var++, gtLabel, recLabel);
+	bool anytime = (_parameters.anytime && _parameters.timeout > 0);
 
-	// cell label selection activates match
-	for (size_t gtLabel : groundTruthLabels) {
-		for (size_t recLabel : possibleMatchesByGt[gtLabel]) {
+	// with a time budget or an approximation, suboptimal solutions are 
+	// expected
+	bool exact = (!anytime && _parameters.approximation == TolerantEditDistanceComponent::Exact);
+	double threadTime = _parameters.timeout*std::min<size_t>(getNumWorkerThreads(_parameters.numThreads), components.size());
 
-			unsigned int matchVar = getMatchVariable(gtLabel, recLabel);
+	// Only components with ambiguous cells reach the solver backend. If 
+	// several of them are solved concurrently, each backend gets a single 
+	// thread, otherwise every backend would use all cores.
+	size_t numSolved = std::count_if(numAmbiguousCells.begin(), numAmbiguousCells.end(), [](size_t n) { return n > 0; });
+	bool concurrent = (std::min<size_t>(getNumWorkerThreads(_parameters.numThreads), numSolved) > 1);
 
-			// no assignment of gtLabel to recLabel -> match is zero
-			LinearConstraint noMatchConstraint;
+	auto start = std::chrono::steady_clock::now();
 
-			for (unsigned int v : getIndicatorsGtToRec(gtLabel, recLabel)) {
+	parallelFor(
+			components.size(),
+			_parameters.numThreads,
+			[&](size_t i) {
 
-				noMatchConstraint.setCoefficient(v, 1);
+				TolerantEditDistanceComponent::Parameters parameters;
+				parameters.timeout       = _parameters.timeout;
+				parameters.numThreads    = (concurrent ? 1 : _parameters.numThreads);
+				parameters.solverBackend = _parameters.solverBackend;
+				parameters.approximation = _parameters.approximation;
+				parameters.formulation   = _parameters.formulation;
 
-				// at least one assignment of gtLabel to recLabel -> match is 
-				// one
-				LinearConstraint matchConstraint;
-				matchConstraint.setCoefficient(matchVar, 1);
-				matchConstraint.setCoefficient(v, -1);
-				matchConstraint.setRelation(GreaterEqual);
-				matchConstraint.setValue(0);
-				constraints.add(matchConstraint);
+				if (anytime && numAmbiguousCells[i] > 0) {
 
-				//LOG_ALL(tedlog) << matchConstraint << std::endl;
-			}
+					double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+					double share = threadTime*numAmbiguousCells[i]/totalAmbiguousCells;
 
-			noMatchConstraint.setCoefficient(matchVar, -1);
-			noMatchConstraint.setRelation(GreaterEqual);
-			noMatchConstraint.setValue(0);
-			constraints.add(noMatchConstraint);
+					parameters.timeout = std::min(share, _parameters.timeout - elapsed);
 
-			//LOG_ALL(tedlog) << noMatchConstraint << std::endl;
-		}
-	}
+					// no time left, skip the solver
+					if (parameters.timeout <= 0)
+						parameters.timeout = -1;
+				}
 
-	// introduce split number for each ground truth label
+				components[i].solve(parameters);
+			});
 
-	unsigned int splitBegin = var;
+	_inferenceTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
 
-	for (size_t gtLabel : groundTruthLabels) {
+	for (unsigned int i = 0; i < components.size(); i++) {
 
-		unsigned int splitVar = var++;
+		const TolerantEditDistanceComponent& component = components[i];
 
-		//LOG_ALL(tedlog) << "adding split var " << splitVar << " for gt label " << gtLabel << std::endl;
+		if (!component.isOptimal()) {
 
-		specialVariableTypes[splitVar] = Integer;
+			if (exact)
+				LOG_ERROR(tedlog) << "Optimal solution NOT found: " << component.getSolverMessage() << std::endl;
+			else
+				LOG_DEBUG(tedlog) << "Optimal solution NOT found: " << component.getSolverMessage() << std::endl;
+		}
 
-		LinearConstraint positive;
-		positive.setCoefficient(splitVar, 1);
-		positive.setRelation(GreaterEqual);
-		positive.setValue(0);
-		constraints.add(positive);
+		ComponentResult& result = results[componentResults[i]];
 
-		LinearConstraint numSplits;
-		numSplits.setCoefficient(splitVar, 1);
-		for (size_t recLabel : possibleMatchesByGt[gtLabel])
-			numSplits.setCoefficient(getMatchVariable(gtLabel, recLabel), -1);
-		numSplits.setRelation(GreaterEqual);
-		numSplits.setValue(-1);
-		constraints.add(numSplits);
+		result.cellIndices = component.getCellIndices();
+		result.cellLabels.resize(result.cellIndices.size());
+		for (unsigned int j = 0; j < result.cellIndices.size(); j++)
+			result.cellLabels[j] = component.getCellLabel(j);
 
-		//LOG_ALL(tedlog) << positive << std::endl;
-		//LOG_ALL(tedlog) << numSplits << std::endl;
+		result.numSplits              = component.getNumSplits();
+		result.numMerges              = component.getNumMerges();
+		result.lowerBound             = component.getLowerBound();
+		result.numVariables           = component.getNumVariables();
+		result.numEliminatedVariables = component.getNumEliminatedVariables();
+		result.numConstraints         = component.getNumConstraints();
+		result.numNonZeros            = component.getNumNonZeros();
 	}
 
-	unsigned int splitEnd = var;
+	// stitch the component solutions together
 
-	// introduce total split number
+	_splits = _numIndicatorVars;
+	_merges = _numIndicatorVars + 1;
+	_solution = Solution(_numIndicatorVars + 2);
+	_numVariables = 0;
+	_numEliminatedVariables = 0;
+	_numConstraints = 0;
+	_numNonZeros = 0;
+	_lowerBound = 0;
 
-	_splits = var++;
-	specialVariableTypes[_splits] = Integer;
+	for (const ComponentResult& result : results) {
 
-	//LOG_ALL(tedlog) << "adding total split var " << _splits << std::endl;
+		for (unsigned int i = 0; i < result.cellIndices.size(); i++) {
 
-	LinearConstraint sumOfSplits;
-	sumOfSplits.setCoefficient(_splits, 1);
-	for (unsigned int i = splitBegin; i < splitEnd; i++)
-		sumOfSplits.setCoefficient(i, -1);
-	sumOfSplits.setRelation(Equal);
-	sumOfSplits.setValue(0);
-	constraints.add(sumOfSplits);
+			unsigned int cellIndex = result.cellIndices[i];
+			size_t       recLabel  = result.cellLabels[i];
 
-	//LOG_ALL(tedlog) << sumOfSplits << std::endl;
+			unsigned int var = _firstIndicatorVar[cellIndex];
+			for (size_t l : cells[cellIndex].getPossibleLabels()) {
 
-	// introduce merge number for each reconstruction label
+				if (l == recLabel)
+					_solution[var] = 1;
+				var++;
+			}
+		}
 
-	unsigned int mergeBegin = var;
+		_solution[_splits] += result.numSplits;
+		_solution[_merges] += result.numMerges;
+		_lowerBound += result.lowerBound;
+		_numVariables += result.numVariables;
+		_numConstraints += result.numConstraints;
+		_numNonZeros += result.numNonZeros;
+		_numEliminatedVariables += result.numEliminatedVariables;
+	}
 
-	for (size_t recLabel : reconstructionLabels) {
+	if (_lowerBound < _solution[_splits] + _solution[_merges])
+		LOG_USER(tedlog)
+				<< "best solution found has " << _solution[_splits] + _solution[_merges]
+				<< " splits and merges, lower bound is " << _lowerBound
+				<< std::endl;
 
-		unsigned int mergeVar = var++;
+	_componentResults = std::move(results);
+}
 
-		//LOG_ALL(tedlog) << "adding merge var " << mergeVar << " for rec label " << recLabel << std::endl;
+bool
+TolerantEditDistance::reuseComponentResult(
+		const std::vector<unsigned int>& cellIndices,
+		const std::vector<unsigned int>& previousCells,
+		ComponentResult& result) {
 
-		specialVariableTypes[mergeVar] = Integer;
+	// all cells have to be in the same previous component, and the previous 
+	// component must not have any other cells
 
-		LinearConstraint positive;
-		positive.setCoefficient(mergeVar, 1);
-		positive.setRelation(GreaterEqual);
-		positive.setValue(0);
-		constraints.add(positive);
+	unsigned int component = Cells::NoCell;
 
-		LinearConstraint numMerges;
-		numMerges.setCoefficient(mergeVar, 1);
-		for (size_t gtLabel : possibleMatchesByRec[recLabel])
-			numMerges.setCoefficient(getMatchVariable(gtLabel, recLabel), -1);
-		numMerges.setRelation(GreaterEqual);
-		numMerges.setValue(-1);
-		constraints.add(numMerges);
+	for (unsigned int cellIndex : cellIndices) {
 
-		//LOG_ALL(tedlog) << positive << std::endl;
-		//LOG_ALL(tedlog) << numMerges << std::endl;
-	}
+		unsigned int previousCell = previousCells[cellIndex];
 
-	unsigned int mergeEnd = var;
+		if (previousCell == Cells::NoCell)
+			return false;
 
-	// introduce total merge number
+		if (component == Cells::NoCell)
+			component = _previousComponents[previousCell].first;
+		else if (_previousComponents[previousCell].first != component)
+			return false;
+	}
+
+	const ComponentResult& previous = _componentResults[component];
 
-	_merges = var++;
-	specialVariableTypes[_merges] = Integer;
+	if (previous.cellIndices.size() != cellIndices.size())
+		return false;
 
-	//LOG_ALL(tedlog) << "adding total merge var " << _splits << std::endl;
+	result = previous;
+	result.cellIndices = cellIndices;
+	for (unsigned int i = 0; i < cellIndices.size(); i++)
+		result.cellLabels[i] = previous.cellLabels[_previousComponents[previousCells[cellIndices[i]]].second];
 
-	LinearConstraint sumOfMerges;
-	sumOfMerges.setCoefficient(_merges, 1);
-	for (unsigned int i = mergeBegin; i < mergeEnd; i++)
-		sumOfMerges.setCoefficient(i, -1);
-	sumOfMerges.setRelation(Equal);
-	sumOfMerges.setValue(0);
-	constraints.add(sumOfMerges);
+	return true;
+}
 
-	//LOG_ALL(tedlog) << sumOfMerges << std::endl;
+std::vector<std::vector<unsigned int>>
+TolerantEditDistance::findComponents(const Cells& cells) {
 
-	// create objective
+	// one node for each ground truth and reconstruction label, ground truth 
+	// labels get the first ids
 
-	LinearObjective objective(var);
+	DenseLabels gtIds;
+	DenseLabels recIds;
 
-	// we want to minimize the number of split and merges
-	objective.setCoefficient(_splits, 1);
-	objective.setCoefficient(_merges, 1);
-	// however, if there are multiple equal solutions, we prefer the ones with 
-	// the least changes -- therefore, we add a small value for each of those 
-	// variables that can not sum up to one and therefor does not change the 
-	// number of splits and merges
-	size_t maxChange = 0;
 	for (const Cell<size_t>& cell : cells)
-		if (cell.getPossibleLabels().size() > 1)
-			maxChange += cell.size();
-	unsigned int ind;
-	size_t cellSize;
-	for (auto& p : _alternativeIndicators) {
-	
-		ind = p.first;
-		cellSize = p.second;
-
-		objective.setCoefficient(ind, static_cast<double>(cellSize)/(maxChange + 1));
+		gtIds.insert(cell.getGroundTruthLabel());
+	for (const Cell<size_t>& cell : cells)
+		for (size_t l : cell.getPossibleLabels())
+			recIds.insert(l);
+
+	UnionFind<unsigned int> nodes(gtIds.size() + recIds.size());
+
+	// connect each ground truth label to the reconstruction labels its cells 
+	// can take
+	std::vector<unsigned int> cellGtIds(cells.size());
+	for (unsigned int cellIndex = 0; cellIndex < cells.size(); cellIndex++) {
+
+		const Cell<size_t>& cell = cells[cellIndex];
+
+		unsigned int gt = gtIds.find(cell.getGroundTruthLabel());
+		cellGtIds[cellIndex] = gt;
+
+		for (size_t l : cell.getPossibleLabels())
+			nodes.merge(gt, gtIds.size() + recIds.find(l));
 	}
-	objective.setSense(Minimize);
 
-	// solve
+	// collect the cells of each component, in the order of their first cell
 
-	SolverFactory factory;
-	std::unique_ptr<LinearSolverBackend> solver = std::unique_ptr<LinearSolverBackend>(factory.createLinearSolverBackend());
+	std::vector<unsigned int> componentIndices(nodes.size(), DenseLabels::NoId);
+	std::vector<std::vector<unsigned int>> components;
 
-	solver->initialize(var, Binary, specialVariableTypes);
-	solver->setObjective(objective);
-	solver->setConstraints(constraints);
-	solver->setTimeout(_parameters.timeout);
+	for (unsigned int cellIndex = 0; cellIndex < cells.size(); cellIndex++) {
 
-	std::string msg;
-	if (!solver->solve(_solution, msg)) {
+		unsigned int root = nodes.find(cellGtIds[cellIndex]);
 
-		LOG_ERROR(tedlog) << "Optimal solution NOT found: " << msg << std::endl;
+		if (componentIndices[root] == DenseLabels::NoId) {
+
+			componentIndices[root] = components.size();
+			components.push_back(std::vector<unsigned int>());
+		}
+
+		components[componentIndices[root]].push_back(cellIndex);
 	}
+
+	return components;
 }
 
 void
-TolerantEditDistance::correctReconstruction(const Cells& cells) {
+TolerantEditDistance::correctReconstruction(const Cells& cells, const ImageStack& reconstruction) {
 
-	// prepare output image
+	// Prepare output image. Start from the reconstruction (or background for 
+	// skeletons), such that only cells that change their label have to be 
+	// painted. Most of the cells are lazy and would have to be materialized 
+	// otherwise.
 
 	for (unsigned int i = 0; i < _depth; i++) {
 
-		_correctedReconstruction.add(std::make_shared<Image>(_width, _height, 0.0));
+		std::shared_ptr<Image> section = std::make_shared<Image>(_width, _height, _parameters.recBackgroundLabel);
+
+		if (!_parameters.fromSkeleton)
+			std::copy(reconstruction[i]->begin(), reconstruction[i]->end(), section->begin());
+
+		_correctedReconstruction.add(section);
 	}
 
 	// read solution
@@ -351,12 +616,57 @@ TolerantEditDistance::correctReconstruction(const Cells& cells) {
 			if (_parameters.fromSkeleton && recLabel == (size_t)-1)
 				recLabel = _parameters.recBackgroundLabel;
 
-			for (const Cell<size_t>::Location& l : cell)
-				(*_correctedReconstruction[l.z])(l.x, l.y) = recLabel;
+			// cells have a constant value in the prepared output image
+			Cell<size_t>::Location seed = cell.getSeed();
+			if ((*_correctedReconstruction[seed.z])(seed.x, seed.y) == (float)recLabel)
+				continue;
+
+			paint(_correctedReconstruction, cell, recLabel);
 		}
 	}
 }
 
+void
+TolerantEditDistance::paint(ImageStack& stack, const Cell<size_t>& cell, float value) {
+
+	for (const Cell<size_t>::Run& run : cell.getRuns()) {
+
+		Image& section = *stack[run.z];
+
+		for (int x = run.xBegin; x < run.xEnd; x++)
+			section(x, run.y) = value;
+	}
+}
+
+void
+TolerantEditDistance::addErrorLocations(
+		const Cells& cells,
+		const std::vector<unsigned int>& cellIndices,
+		size_t gtLabel,
+		size_t recLabel,
+		float value,
+		ImageStack& locations,
+		std::vector<ErrorRuns>& runs) {
+
+	if (_parameters.errorLocations == DenseErrorLocations) {
+
+		for (unsigned int cellIndex : cellIndices)
+			paint(locations, cells[cellIndex], value);
+
+		return;
+	}
+
+	ErrorRuns error;
+	error.gtLabel  = gtLabel;
+	error.recLabel = recLabel;
+
+	for (unsigned int cellIndex : cellIndices)
+		for (const Cell<size_t>::Run& run : cells[cellIndex].getRuns())
+			error.runs.push_back(run);
+
+	runs.push_back(std::move(error));
+}
+
 TolerantEditDistanceErrors
 TolerantEditDistance::findErrors(std::shared_ptr<Cells> pcells) {
 
@@ -366,15 +676,20 @@ TolerantEditDistance::findErrors(std::shared_ptr<Cells> pcells) {
 	if (_parameters.reportFPsFNs)
 		errors = TolerantEditDistanceErrors(_parameters.gtBackgroundLabel, _parameters.recBackgroundLabel);
 
+	errors.setNumThreads(_parameters.numThreads);
+
 	// prepare error location image stack
 
-	for (unsigned int i = 0; i < _depth; i++) {
+	if (_parameters.errorLocations == DenseErrorLocations) {
 
-		// initialize with gray (no cell label)
-		_splitLocations.add(std::make_shared<Image>(_width, _height, 0.33));
-		_mergeLocations.add(std::make_shared<Image>(_width, _height, 0.33));
-		_fpLocations.add(std::make_shared<Image>(_width, _height, 0.33));
-		_fnLocations.add(std::make_shared<Image>(_width, _height, 0.33));
+		for (unsigned int i = 0; i < _depth; i++) {
+
+			// initialize with gray (no cell label)
+			_splitLocations.add(std::make_shared<Image>(_width, _height, 0.33));
+			_mergeLocations.add(std::make_shared<Image>(_width, _height, 0.33));
+			_fpLocations.add(std::make_shared<Image>(_width, _height, 0.33));
+			_fnLocations.add(std::make_shared<Image>(_width, _height, 0.33));
+		}
 	}
 
 	// prepare error data structure
@@ -394,82 +709,42 @@ TolerantEditDistance::findErrors(std::shared_ptr<Cells> pcells) {
 		}
 	}
 
-	// fill error location image stack
+	// fill error locations
 
-	// all cells that changed label within tolerance
+	if (_parameters.errorLocations != NoErrorLocations) {
 
-	// all cells that split the ground truth
-	for (size_t gtLabel : errors.getSplitLabels())
-		for (const auto& errorCells : errors.getSplitCells(gtLabel))
-			for (unsigned int cellIndex : errorCells.second)
-				for (const Cell<size_t>::Location& l : cells[cellIndex])
-					(*_splitLocations[l.z])(l.x, l.y) = errorCells.first;
+		// all cells that changed label within tolerance
 
-	// all cells that split the reconstruction
-	for (size_t recLabel : errors.getMergeLabels())
-		for (const auto& errorCells : errors.getMergeCells(recLabel))
-			for (unsigned int cellIndex : errorCells.second)
-				for (const Cell<size_t>::Location& l : cells[cellIndex])
-					(*_mergeLocations[l.z])(l.x, l.y) = errorCells.first;
+		// all cells that split the ground truth
+		for (size_t gtLabel : errors.getSplitLabels())
+			for (const auto& errorCells : errors.getSplitCells(gtLabel))
+				addErrorLocations(cells, errorCells.second, gtLabel, errorCells.first, errorCells.first, _splitLocations, _splitRuns);
 
-	if (_parameters.reportFPsFNs) {
+		// all cells that split the reconstruction
+		for (size_t recLabel : errors.getMergeLabels())
+			for (const auto& errorCells : errors.getMergeCells(recLabel))
+				addErrorLocations(cells, errorCells.second, errorCells.first, recLabel, errorCells.first, _mergeLocations, _mergeRuns);
 
-		// all cells that are false positives
-		for (const auto& errorCells : errors.getFalsePositiveCells())
-			if (errorCells.first != _parameters.recBackgroundLabel) {
-				for (unsigned int cellIndex : errorCells.second)
-					for (const Cell<size_t>::Location& l : cells[cellIndex])
-						(*_fpLocations[l.z])(l.x, l.y) = errorCells.first;
-			}
+		if (_parameters.reportFPsFNs) {
 
-		// all cells that are false negatives
-		for (const auto& errorCells : errors.getFalseNegativeCells())
-			if (errorCells.first != _parameters.gtBackgroundLabel) {
-				for (unsigned int cellIndex : errorCells.second)
-					for (const Cell<size_t>::Location& l : cells[cellIndex])
-						(*_fnLocations[l.z])(l.x, l.y) = errorCells.first;
-			}
+			// all cells that are false positives
+			for (const auto& errorCells : errors.getFalsePositiveCells())
+				if (errorCells.first != _parameters.recBackgroundLabel)
+					addErrorLocations(cells, errorCells.second, _parameters.gtBackgroundLabel, errorCells.first, errorCells.first, _fpLocations, _fpRuns);
+
+			// all cells that are false negatives
+			for (const auto& errorCells : errors.getFalseNegativeCells())
+				if (errorCells.first != _parameters.gtBackgroundLabel)
+					addErrorLocations(cells, errorCells.second, errorCells.first, _parameters.recBackgroundLabel, errorCells.first, _fnLocations, _fnRuns);
+		}
 	}
 
-	errors.setInferenceTime(_solution.getTime());
-	errors.setNumVariables(_solution.size());
+	errors.setInferenceTime(_inferenceTime);
+	errors.setLowerBound(_lowerBound);
+	errors.setNumVariables(_numVariables);
+	errors.setNumConstraints(_numConstraints);
+	errors.setNumNonZeros(_numNonZeros);
+	errors.setNumEliminatedVariables(_numEliminatedVariables);
 
 	return errors;
 }
-
-void
-TolerantEditDistance::assignIndicatorVariable(unsigned int var, unsigned int cellIndex, size_t gtLabel, size_t recLabel) {
-
-	//LOG_ALL(tedlog) << "adding indicator var " << var << " to assign label " << recLabel << " to cell " << cellIndex << std::endl;
-
-	_indicatorVarsByRecLabel[recLabel].push_back(var);
-	_indicatorVarsByGtToRecLabel[gtLabel][recLabel].push_back(var);
-
-	_labelingByVar[var] = std::make_pair(cellIndex, recLabel);
-}
-
-std::vector<unsigned int>&
-TolerantEditDistance::getIndicatorsByRec(size_t recLabel) {
-
-	return _indicatorVarsByRecLabel[recLabel];
-}
-
-std::vector<unsigned int>&
-TolerantEditDistance::getIndicatorsGtToRec(size_t gtLabel, size_t recLabel) {
-
-	return _indicatorVarsByGtToRecLabel[gtLabel][recLabel];
-}
-
-void
-TolerantEditDistance::assignMatchVariable(unsigned int var, size_t gtLabel, size_t recLabel) {
-
-	//LOG_ALL(tedlog) << "adding indicator var " << var << " to match gt label " << gtLabel << " to rec label " << recLabel << std::endl;
-
-	_matchVars[gtLabel][recLabel] = var;
-}
-
-unsigned int
-TolerantEditDistance::getMatchVariable(size_t gtLabel, size_t recLabel) {
-
-	return _matchVars[gtLabel][recLabel];
-}
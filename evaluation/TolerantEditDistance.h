@@ -3,13 +3,51 @@
 
 #include <imageprocessing/ImageStack.h>
 #include <inference/Solution.h>
-#include "LocalToleranceFunction.h"
+#include "DistanceToleranceFunction.h"
+#include "SolverBackend.h"
+#include "TolerantEditDistanceComponent.h"
 #include "TolerantEditDistanceErrors.h"
 
 class TolerantEditDistance {
 
 public:
 
+	/**
+	 * Whether and how to report the locations of the errors.
+	 */
+	enum ErrorLocations {
+
+		/**
+		 * Do not report error locations.
+		 */
+		NoErrorLocations,
+
+		/**
+		 * Report the runs of locations of each error, see getSplitRuns() and 
+		 * friends.
+		 */
+		SparseErrorLocations,
+
+		/**
+		 * Report the error locations as image stacks of the size of the 
+		 * ground truth, see getSplitLocations() and friends.
+		 */
+		DenseErrorLocations
+	};
+
+	/**
+	 * The locations of one error, i.e., of the cells of one match between a 
+	 * ground truth and a reconstruction label that is part of a split, 
+	 * merge, false positive, or false negative.
+	 */
+	struct ErrorRuns {
+
+		size_t gtLabel;
+		size_t recLabel;
+
+		std::vector<Cell<size_t>::Run> runs;
+	};
+
 	struct Parameters {
 
 		Parameters() :
@@ -19,7 +57,15 @@ public:
 			allowBackgroundAppearance(false),
 			gtBackgroundLabel(0),
 			recBackgroundLabel(0),
-			timeout(0) {}
+			timeout(0),
+			anytime(false),
+			numThreads(0),
+			alternativeLabelSearch(DistanceToleranceFunction::NeighborhoodScan),
+			cellExtraction(LocalToleranceFunction::BlockwiseUnionFind),
+			solverBackend(ExternalSolver),
+			approximation(TolerantEditDistanceComponent::Exact),
+			formulation(TolerantEditDistanceComponent::Standard),
+			errorLocations(NoErrorLocations) {}
 
 		/**
 		* True if the ground-truth consists of skeletons. In this case, the 
@@ -55,6 +101,59 @@ public:
 		 * Timeout for the ILP in seconds. 0 for no limit.
 		 */
 		double timeout;
+
+		/**
+		 * If true, the timeout is a budget for the whole ILP instead of for 
+		 * each independent component. The budget is shared between the 
+		 * components in proportion to their number of ambiguous cells. 
+		 * Components that run out of time keep the best solution found so 
+		 * far, and the errors report a lower bound and the optimality gap.
+		 */
+		bool anytime;
+
+		/**
+		 * The number of threads to use. 0 for all available hardware threads.
+		 */
+		unsigned int numThreads;
+
+		/**
+		 * The method to find alternative labels for each cell within the 
+		 * distance threshold.
+		 */
+		DistanceToleranceFunction::AlternativeLabelSearch alternativeLabelSearch;
+
+		/**
+		 * The method to extract cells from the ground truth and 
+		 * reconstruction.
+		 */
+		LocalToleranceFunction::CellExtraction cellExtraction;
+
+		/**
+		 * The linear solver backend to solve the ILP with.
+		 */
+		SolverBackend solverBackend;
+
+		/**
+		 * Whether to approximate the ILP solution for a speedup. With 
+		 * LpRelaxation, the LP relaxation is rounded to a labeling, and the 
+		 * errors report the LP bound as their lower bound. Greedy does not 
+		 * solve any ILP or LP, and is meant for frequent evaluations, e.g., 
+		 * during training.
+		 */
+		TolerantEditDistanceComponent::Approximation approximation;
+
+		/**
+		 * How to formulate the ILP. The Compact formulation has fewer 
+		 * constraints and breaks symmetries between interchangeable cells.
+		 */
+		TolerantEditDistanceComponent::Formulation formulation;
+
+		/**
+		 * Whether to report the locations of the errors after compute() and 
+		 * update(). Dense locations need four float image stacks of the size 
+		 * of the ground truth.
+		 */
+		ErrorLocations errorLocations;
 	};
 
 	TolerantEditDistance(const Parameters& parameters = Parameters());
@@ -64,42 +163,206 @@ public:
 	 */
 	TolerantEditDistanceErrors compute(const ImageStack& groundTruth, const ImageStack& reconstruction);
 
+	/**
+	 * Set the ground-truth for the following calls to compute(reconstruction). 
+	 * Everything that depends on the ground-truth only is kept between these 
+	 * calls, so that many reconstructions can be evaluated against the same 
+	 * ground-truth without preparing it again. The sections of the given 
+	 * stack are shared, and must not be modified afterwards.
+	 */
+	void setGroundTruth(const ImageStack& groundTruth);
+
+	/**
+	 * Compute errors for the given reconstruction and the ground-truth set 
+	 * with setGroundTruth().
+	 */
+	TolerantEditDistanceErrors compute(const ImageStack& reconstruction);
+
+	/**
+	 * Compute errors for the given reconstruction (and the ground-truth set 
+	 * with setGroundTruth()) for several distance thresholds at once, instead 
+	 * of the one in the parameters. Cells and boundary distances are found 
+	 * only once for the largest threshold, and the ILP of each threshold 
+	 * starts from the solution of the previous one.
+	 *
+	 * @param distanceThresholds
+	 *             The distance thresholds, in increasing order.
+	 *
+	 * @return
+	 *             The errors for each distance threshold. 
+	 *             getCorrectedReconstruction() returns the corrected 
+	 *             reconstruction for the largest threshold afterwards, the 
+	 *             error locations are the ones of the largest threshold as 
+	 *             well.
+	 */
+	std::vector<TolerantEditDistanceErrors> compute(
+			const ImageStack& reconstruction,
+			const std::vector<unsigned int>& distanceThresholds);
+
+	/**
+	 * Update the errors of the last call to compute(reconstruction) or 
+	 * update() after local edits of the reconstruction, e.g., merges or 
+	 * splits of a few segments. Only cells within the distance threshold of 
+	 * the changed locations are extracted and searched for alternative 
+	 * labels again, and only components of the ILP with changed cells are 
+	 * solved again. Same as compute(reconstruction), if there is no previous 
+	 * result.
+	 *
+	 * The sections of the previous reconstruction must not have been 
+	 * modified in place.
+	 *
+	 * @param changedLabels
+	 *             Reconstruction labels such that every changed location 
+	 *             has one of them before or after the change, e.g., the 
+	 *             label that was merged into another one. Only sections that 
+	 *             are not shared with the previous reconstruction are 
+	 *             searched for them.
+	 */
+	TolerantEditDistanceErrors update(
+			const ImageStack& reconstruction,
+			const std::vector<size_t>& changedLabels);
+
+	/**
+	 * Same as update(reconstruction, changedLabels), for a box 
+	 * [changedBegin, changedEnd) that contains all locations where the 
+	 * reconstruction changed.
+	 */
+	TolerantEditDistanceErrors update(
+			const ImageStack& reconstruction,
+			const vigra::Shape3& changedBegin,
+			const vigra::Shape3& changedEnd);
+
 	/**
 	 * After a call to compute(), get a corrected version of the reconstruction, 
 	 * which was chosen to be as close as possible to the ground-truth.
 	 */
 	const ImageStack& getCorrectedReconstruction() { return _correctedReconstruction; }
 
+	/**
+	 * With DenseErrorLocations, get an image stack that shows for each split 
+	 * location the reconstruction label that splits the ground truth there. 
+	 * All other locations are 0.33. Empty otherwise.
+	 */
+	const ImageStack& getSplitLocations() const { return _splitLocations; }
+
+	/**
+	 * Same as getSplitLocations(), showing the ground truth labels that are 
+	 * merged by the reconstruction.
+	 */
+	const ImageStack& getMergeLocations() const { return _mergeLocations; }
+
+	/**
+	 * Same as getSplitLocations(), for false positives. Only with reportFPsFNs.
+	 */
+	const ImageStack& getFalsePositiveLocations() const { return _fpLocations; }
+
+	/**
+	 * Same as getSplitLocations(), for false negatives. Only with 
+	 * reportFPsFNs.
+	 */
+	const ImageStack& getFalseNegativeLocations() const { return _fnLocations; }
+
+	/**
+	 * With SparseErrorLocations, get the locations of each split, by ground 
+	 * truth and reconstruction label. Empty otherwise.
+	 */
+	const std::vector<ErrorRuns>& getSplitRuns() const { return _splitRuns; }
+
+	/**
+	 * Same as getSplitRuns(), for merges.
+	 */
+	const std::vector<ErrorRuns>& getMergeRuns() const { return _mergeRuns; }
+
+	/**
+	 * Same as getSplitRuns(), for false positives. Only with reportFPsFNs.
+	 */
+	const std::vector<ErrorRuns>& getFalsePositiveRuns() const { return _fpRuns; }
+
+	/**
+	 * Same as getSplitRuns(), for false negatives. Only with reportFPsFNs.
+	 */
+	const std::vector<ErrorRuns>& getFalseNegativeRuns() const { return _fnRuns; }
+
 private:
 
-	void reset(const ImageStack& groundTruth, const ImageStack& reconstruction);
+	void reset(const ImageStack& reconstruction);
 
-	void minimizeErrors(const Cells& cells);
+	// clear everything that depends on the possible labels of the cells
+	void resetSolution();
 
-	void correctReconstruction(const Cells& cells);
+	// the solution of one independent component
+	struct ComponentResult {
 
-	TolerantEditDistanceErrors findErrors(std::shared_ptr<Cells> cells);
+		std::vector<unsigned int> cellIndices;
+		std::vector<size_t>       cellLabels;
 
-	void assignIndicatorVariable(unsigned int var, unsigned int cellIndex, size_t gtLabel, size_t recLabel);
+		unsigned int numSplits;
+		unsigned int numMerges;
+		unsigned int lowerBound;
+		unsigned int numVariables;
+		unsigned int numEliminatedVariables;
+		unsigned int numConstraints;
+		size_t       numNonZeros;
+	};
 
-	std::vector<unsigned int>& getIndicatorsByRec(size_t recLabel);
+	// solve the ILP for the given cells, reusing the results of previous 
+	// components that consist of the same cells
+	//
+	// @param previousCells
+	//             For each cell, the index of a previous cell that enters 
+	//             the ILP the same way, or Cells::NoCell. Empty to solve all 
+	//             components.
+	void minimizeErrors(
+			const Cells& cells,
+			const std::vector<unsigned int>& previousCells = std::vector<unsigned int>());
+
+	// if the given component consists of the same cells as a previous 
+	// component, set result to the previous result for the given cells
+	bool reuseComponentResult(
+			const std::vector<unsigned int>& cellIndices,
+			const std::vector<unsigned int>& previousCells,
+			ComponentResult& result);
+
+	// partition the cells into independent components of the GT-REC possible 
+	// match graph
+	std::vector<std::vector<unsigned int>> findComponents(const Cells& cells);
+
+	void correctReconstruction(const Cells& cells, const ImageStack& reconstruction);
 
-	std::vector<unsigned int>& getIndicatorsGtToRec(size_t gtLabel, size_t recLabel);
+	TolerantEditDistanceErrors findErrors(std::shared_ptr<Cells> cells);
 
-	void assignMatchVariable(unsigned int var, size_t gtLabel, size_t recLabel);
+	// set all locations of the given cell in the given image stack to value
+	void paint(ImageStack& stack, const Cell<size_t>& cell, float value);
 
-	unsigned int getMatchVariable(size_t gtLabel, size_t recLabel);
+	// report the locations of the cells of one error, as configured in the 
+	// parameters, painted with value in the dense locations
+	void addErrorLocations(
+			const Cells& cells,
+			const std::vector<unsigned int>& cellIndices,
+			size_t gtLabel,
+			size_t recLabel,
+			float value,
+			ImageStack& locations,
+			std::vector<ErrorRuns>& runs);
 
 	Parameters _parameters;
 
+	ImageStack _groundTruth;
+	bool       _haveGroundTruth;
+
 	ImageStack _correctedReconstruction;
 	ImageStack _splitLocations;
 	ImageStack _mergeLocations;
 	ImageStack _fpLocations;
 	ImageStack _fnLocations;
 
+	std::vector<ErrorRuns> _splitRuns;
+	std::vector<ErrorRuns> _mergeRuns;
+	std::vector<ErrorRuns> _fpRuns;
+	std::vector<ErrorRuns> _fnRuns;
+
 	// the local tolerance function to use
-	std::unique_ptr<LocalToleranceFunction> _toleranceFunction;
+	std::unique_ptr<DistanceToleranceFunction> _toleranceFunction;
 
 	// the extends of the ground truth and reconstruction
 	unsigned int _width, _height, _depth;
@@ -107,31 +370,54 @@ private:
 	// the number of cells
 	unsigned int _numCells;
 
-	// reconstruction label indicators by reconstruction label
-	std::map<size_t, std::vector<unsigned int> > _indicatorVarsByRecLabel;
-
-	// reconstruction label indicators by groundtruth label x reconstruction 
-	// label
-	std::map<size_t, std::map<size_t, std::vector<unsigned int> > > _indicatorVarsByGtToRecLabel;
-
 	// (cell index, new label) by indicator variable
-	std::map<unsigned int, std::pair<unsigned int, size_t> > _labelingByVar;
+	std::vector<std::pair<unsigned int, size_t> > _labelingByVar;
 
-	// map from ground truth label x reconstruction label to match variable
-	std::map<size_t, std::map<size_t, unsigned int> > _matchVars;
+	// the first indicator variable of each cell
+	std::vector<unsigned int> _firstIndicatorVar;
 
-	// the number of indicator variables in the ILP
+	// the number of indicator variables
 	unsigned int _numIndicatorVars;
 
-	// indicators for alternative cell labels, and the corresponding cell size
-	std::vector<std::pair<unsigned int, size_t> > _alternativeIndicators;
+	// if not empty, the label of each cell to start the search from
+	std::vector<size_t> _startLabels;
+
+	// the cells and reconstruction of the last result, for update()
+	std::shared_ptr<Cells> _cells;
+	ImageStack             _reconstruction;
+
+	// the solution of each component of the last result
+	std::vector<ComponentResult> _componentResults;
 
-	// the ILP variables for the number of splits and merges
+	// during update(), the component and position in it of each previous 
+	// cell
+	std::vector<std::pair<unsigned int, unsigned int>> _previousComponents;
+
+	// the variables for the number of splits and merges in _solution
 	unsigned int _splits;
 	unsigned int _merges;
 
-	// the solution of the ILP
+	// the combined solution of all component ILPs, consisting of the indicator 
+	// variables followed by the total number of splits and merges
 	Solution _solution;
+
+	// the number of variables in all component ILPs
+	unsigned int _numVariables;
+
+	// the number of variables that were determined without the solver
+	unsigned int _numEliminatedVariables;
+
+	// the number of constraints and of their non-zero coefficients in all 
+	// component ILPs
+	unsigned int _numConstraints;
+	size_t _numNonZeros;
+
+	// wall-clock time spent on solving all components
+	double _inferenceTime;
+
+	// a lower bound on the number of splits and merges, summed over all 
+	// components
+	unsigned int _lowerBound;
 };
 
 #endif // TED_EVALUATION_TOLERANT_EDIT_DISTANCE_H__
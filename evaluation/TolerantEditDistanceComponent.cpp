@@ -0,0 +1,1051 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include <inference/LinearObjective.h>
+#include <inference/LinearSolverBackend.h>
+#include <util/exceptions.h>
+#include <util/Logger.h>
+#include "BranchAndBoundSolver.h"
+#include "TolerantEditDistanceComponent.h"
+
+logger::LogChannel tedcomponentlog("tedcomponentlog", "[TolerantEditDistanceComponent] ");
+
+namespace {
+
+double getObjectiveValue(const LinearObjective& objective, const Solution& solution) {
+
+	const std::vector<double>& coefficients = objective.getCoefficients();
+
+	double value = objective.getConstant();
+	for (unsigned int i = 0; i < std::min<size_t>(coefficients.size(), solution.size()); i++)
+		value += coefficients[i]*solution[i];
+
+	return value;
+}
+
+// the costs of all changes sum up to less than one, such that the number of 
+// errors is at least a bound of the objective rounded down
+unsigned int getErrorBound(double objectiveBound, unsigned int maxErrors) {
+
+	double bound = std::floor(objectiveBound + 1e-6);
+
+	return static_cast<unsigned int>(std::max(0.0, std::min(bound, static_cast<double>(maxErrors))));
+}
+
+} // anonymous namespace
+
+TolerantEditDistanceComponent::TolerantEditDistanceComponent(
+		const Cells& cells,
+		const std::vector<unsigned int>& cellIndices) :
+	_cells(cells),
+	_cellIndices(cellIndices),
+	_numEliminatedVariables(0),
+	_fixedMatchesWeight(0),
+	_stamp(0),
+	_firstMatchVar(0),
+	_numIndicatorVars(0),
+	_splits(0),
+	_merges(0),
+	_numConstraints(0),
+	_numNonZeros(0),
+	_optimal(false),
+	_numSplits(0),
+	_numMerges(0),
+	_lowerBound(0) {}
+
+void
+TolerantEditDistanceComponent::setStartLabels(const std::vector<size_t>& cellLabels) {
+
+	_startLabels.clear();
+	for (unsigned int cellIndex : _cellIndices)
+		_startLabels.push_back(cellLabels[cellIndex]);
+}
+
+void
+TolerantEditDistanceComponent::solve(const Parameters& parameters) {
+
+	presolve();
+
+	if (_ambiguousCells.size() == 0) {
+
+		LOG_ALL(tedcomponentlog)
+				<< "component with " << _cellIndices.size()
+				<< " cells has no alternative labels, skipping solver"
+				<< std::endl;
+
+		// the original labeling is the only solution
+		_optimal = true;
+		readSolution();
+		_lowerBound = _numSplits + _numMerges;
+		return;
+	}
+
+	LOG_ALL(tedcomponentlog)
+			<< "solving component with "
+			<< _ambiguousCells.size() << " ambiguous cells (out of "
+			<< _cellIndices.size() << "), "
+			<< _gtIds.size()
+			<< " ground truth labels and "
+			<< _recIds.size()
+			<< " reconstruction labels"
+			<< std::endl;
+
+	SparseConstraints constraints;
+
+	// the default are binary variables
+	std::map<unsigned int, VariableType> specialVariableTypes;
+
+	// introduce indicators for each ambiguous cell and each possible label of 
+	// that cell
+	_indicatorVarsByMatch.assign(_possibleMatches.size(), std::vector<unsigned int>());
+	_labelingByVar.clear();
+	_matchByVar.clear();
+	_firstIndicatorVars.clear();
+	std::vector<unsigned int> originalChoices;
+	std::vector<unsigned int> startChoices;
+	unsigned int var = 0;
+	for (unsigned int i : _ambiguousCells) {
+
+		const Cell<size_t>& cell = _cells[_cellIndices[i]];
+		unsigned int gtId = _cellGtIds[i];
+
+		// first indicator variable for this cell
+		unsigned int begin = var;
+		_firstIndicatorVars.push_back(begin);
+		originalChoices.push_back(begin);
+
+		// one variable for each possible label
+		for (size_t l : cell.getPossibleLabels()) {
+
+			unsigned int ind = var++;
+			_labelingByVar.push_back(std::make_pair(i, l));
+
+			unsigned int match = _possibleMatches.find(getMatchKey(gtId, _recIds.find(l)));
+			if (match != DenseLabels::NoId)
+				_indicatorVarsByMatch[match].push_back(ind);
+			_matchByVar.push_back(match);
+
+			if (l != cell.getReconstructionLabel())
+				_alternativeIndicators.push_back(std::make_pair(ind, cell.size()));
+			else
+				originalChoices.back() = ind;
+		}
+
+		// start from the given label, if it is possible
+		startChoices.push_back(originalChoices.back());
+		if (!_startLabels.empty())
+			for (unsigned int ind = begin; ind < var; ind++)
+				if (_labelingByVar[ind].second == _startLabels[i])
+					startChoices.back() = ind;
+	}
+	_numIndicatorVars = var;
+	_firstIndicatorVars.push_back(var);
+
+	// the cost of each indicator in the objective, to prefer solutions with 
+	// the least changes among the ones with the same number of errors (see 
+	// below)
+	size_t maxChange = 0;
+	for (unsigned int i : _ambiguousCells)
+		maxChange += _cells[_cellIndices[i]].size();
+	std::vector<double> changeCosts(_numIndicatorVars, 0);
+	for (auto& p : _alternativeIndicators)
+		changeCosts[p.first] = static_cast<double>(p.second)/(maxChange + 1);
+
+	if (parameters.approximation == Greedy) {
+
+		solveGreedily(startChoices, changeCosts);
+		_numEliminatedVariables -= _numIndicatorVars;
+
+		readSolution();
+		return;
+	}
+
+	// reserve enough for the standard formulation: one row per cell, up to 
+	// one per indicator and one per match to link them, and two per label 
+	// for the splits and merges
+	constraints.reserve(
+			_ambiguousCells.size() + _numIndicatorVars + _possibleMatches.size() + 2*(_gtIds.size() + _recIds.size()) + 3,
+			4*_numIndicatorVars + 4*_possibleMatches.size() + 2*(_gtIds.size() + _recIds.size()) + 2);
+
+	// every cell needs to have a label
+	for (unsigned int i = 0; i < _ambiguousCells.size(); i++) {
+
+		constraints.addRow(Equal, 1);
+		for (unsigned int ind = _firstIndicatorVars[i]; ind < _firstIndicatorVars[i + 1]; ind++)
+			constraints.addCoefficient(ind, 1.0);
+	}
+
+	// introduce indicators for each match of ground truth label to 
+	// reconstruction label that is not fixed already
+	_firstMatchVar = var;
+	var += _possibleMatches.size();
+
+	bool compact = (parameters.formulation == Compact);
+
+	// cell label selection activates match
+	for (unsigned int match = 0; match < _possibleMatches.size(); match++) {
+
+		unsigned int matchVar = _firstMatchVar + match;
+		const std::vector<unsigned int>& indicators = _indicatorVarsByMatch[match];
+
+		// at least one assignment of gtLabel to recLabel -> match is one, 
+		// aggregated over all assignments in the compact formulation
+		if (compact) {
+
+			constraints.addRow(GreaterEqual, 0);
+			constraints.addCoefficient(matchVar, indicators.size());
+			for (unsigned int v : indicators)
+				constraints.addCoefficient(v, -1);
+
+		} else {
+
+			for (unsigned int v : indicators) {
+
+				constraints.addRow(GreaterEqual, 0);
+				constraints.addCoefficient(matchVar, 1);
+				constraints.addCoefficient(v, -1);
+			}
+		}
+
+		// no assignment of gtLabel to recLabel -> match is zero
+		constraints.addRow(GreaterEqual, 0);
+		for (unsigned int v : indicators)
+			constraints.addCoefficient(v, 1);
+		constraints.addCoefficient(matchVar, -1);
+	}
+
+	// introduce split number for each ground truth label with undecided 
+	// matches, the splits of all other ground truth labels are constant
+
+	// every ground truth label has at least one match, such that in the 
+	// compact formulation, its number of splits is a linear function of its 
+	// matches that is added directly to the total
+	std::vector<unsigned int> linearSplitMatches;
+
+	int numFixedSplits = 0;
+	unsigned int splitBegin = var;
+	_splitVars.clear();
+
+	for (unsigned int gtId = 0; gtId < _gtIds.size(); gtId++) {
+
+		unsigned int numFixedMatches = _numFixedMatchesByGt[gtId];
+
+		if (_possibleMatchesByGt[gtId].empty() || compact) {
+
+			numFixedSplits += static_cast<int>(numFixedMatches) - 1;
+			for (unsigned int match : _possibleMatchesByGt[gtId])
+				linearSplitMatches.push_back(_firstMatchVar + match);
+			continue;
+		}
+
+		unsigned int splitVar = var++;
+		_splitVars.push_back(std::make_pair(gtId, splitVar));
+
+		specialVariableTypes[splitVar] = Integer;
+
+		// positive
+		constraints.addRow(GreaterEqual, 0);
+		constraints.addCoefficient(splitVar, 1);
+
+		// number of splits
+		constraints.addRow(GreaterEqual, static_cast<double>(numFixedMatches) - 1);
+		constraints.addCoefficient(splitVar, 1);
+		for (unsigned int match : _possibleMatchesByGt[gtId])
+			constraints.addCoefficient(_firstMatchVar + match, -1);
+	}
+
+	unsigned int splitEnd = var;
+
+	// introduce total split number
+
+	_splits = var++;
+	specialVariableTypes[_splits] = Integer;
+
+	constraints.addRow(Equal, numFixedSplits);
+	constraints.addCoefficient(_splits, 1);
+	for (unsigned int i = splitBegin; i < splitEnd; i++)
+		constraints.addCoefficient(i, -1);
+	for (unsigned int matchVar : linearSplitMatches)
+		constraints.addCoefficient(matchVar, -1);
+
+	// introduce merge number for each reconstruction label with undecided 
+	// matches, the merges of all other reconstruction labels are constant
+
+	// in the compact formulation, the merges of reconstruction labels with 
+	// fixed matches are a linear function of their possible matches as well
+	std::vector<unsigned int> linearMergeMatches;
+
+	unsigned int numFixedMerges = 0;
+	unsigned int mergeBegin = var;
+	_mergeVars.clear();
+
+	for (unsigned int recId = 0; recId < _recIds.size(); recId++) {
+
+		unsigned int numFixedMatches = _numFixedMatchesByRec[recId];
+
+		if (_possibleMatchesByRec[recId].empty() || (compact && numFixedMatches > 0)) {
+
+			if (numFixedMatches > 0)
+				numFixedMerges += numFixedMatches - 1;
+			for (unsigned int match : _possibleMatchesByRec[recId])
+				linearMergeMatches.push_back(_firstMatchVar + match);
+			continue;
+		}
+
+		unsigned int mergeVar = var++;
+		_mergeVars.push_back(std::make_pair(recId, mergeVar));
+
+		specialVariableTypes[mergeVar] = Integer;
+
+		// positive
+		constraints.addRow(GreaterEqual, 0);
+		constraints.addCoefficient(mergeVar, 1);
+
+		// number of merges
+		constraints.addRow(GreaterEqual, static_cast<double>(numFixedMatches) - 1);
+		constraints.addCoefficient(mergeVar, 1);
+		for (unsigned int match : _possibleMatchesByRec[recId])
+			constraints.addCoefficient(_firstMatchVar + match, -1);
+	}
+
+	unsigned int mergeEnd = var;
+
+	// introduce total merge number
+
+	_merges = var++;
+	specialVariableTypes[_merges] = Integer;
+
+	constraints.addRow(Equal, numFixedMerges);
+	constraints.addCoefficient(_merges, 1);
+	for (unsigned int i = mergeBegin; i < mergeEnd; i++)
+		constraints.addCoefficient(i, -1);
+	for (unsigned int matchVar : linearMergeMatches)
+		constraints.addCoefficient(matchVar, -1);
+
+	// identical cells can swap their labels without changing the objective, 
+	// only consider solutions where their label positions do not decrease
+
+	_identicalCells.clear();
+	if (compact)
+		findIdenticalCells();
+
+	for (const std::vector<unsigned int>& group : _identicalCells)
+		for (unsigned int k = 1; k < group.size(); k++) {
+
+			unsigned int a = group[k - 1];
+			unsigned int b = group[k];
+
+			constraints.addRow(LessEqual, 0);
+			for (unsigned int pos = 1; pos < _firstIndicatorVars[a + 1] - _firstIndicatorVars[a]; pos++) {
+
+				constraints.addCoefficient(_firstIndicatorVars[a] + pos, pos);
+				constraints.addCoefficient(_firstIndicatorVars[b] + pos, -static_cast<double>(pos));
+			}
+		}
+
+	// create objective
+
+	LinearObjective objective(var);
+
+	// we want to minimize the number of split and merges
+	objective.setCoefficient(_splits, 1);
+	objective.setCoefficient(_merges, 1);
+	// however, if there are multiple equal solutions, we prefer the ones with
+	// the least changes -- therefore, we add a small value for each of those
+	// variables that can not sum up to one and therefor does not change the
+	// number of splits and merges
+	for (auto& p : _alternativeIndicators)
+		objective.setCoefficient(p.first, changeCosts[p.first]);
+	objective.setSense(Minimize);
+
+	// warm start: the original labeling is always feasible, and greedily 
+	// relabeling cells from there (or from the given start labels) is 
+	// usually close to optimal
+
+	std::vector<unsigned int> greedyChoices = startChoices;
+	improveGreedily(greedyChoices, objective.getCoefficients());
+	sortIdenticalChoices(greedyChoices);
+
+	Solution originalSolution = createSolution(originalChoices, var);
+	Solution greedySolution   = createSolution(greedyChoices, var);
+
+	unsigned int greedyErrors = greedySolution[_splits] + greedySolution[_merges];
+
+	LOG_ALL(tedcomponentlog)
+			<< "original labeling has "
+			<< originalSolution[_splits] + originalSolution[_merges]
+			<< " errors, greedy labeling " << greedyErrors
+			<< std::endl;
+
+	// no need to look for solutions with more errors than the greedy one
+	constraints.addRow(LessEqual, greedyErrors);
+	constraints.addCoefficient(_splits, 1);
+	constraints.addCoefficient(_merges, 1);
+
+	_numConstraints = constraints.size();
+	_numNonZeros = constraints.getNumNonZeros();
+
+	std::vector<double> lower(var, 0);
+	std::vector<double> upper(var, 1);
+	_lowerBound = getErrorBound(getObjectiveBound(objective.getCoefficients(), lower, upper), greedyErrors);
+
+	if (parameters.timeout < 0) {
+
+		_optimal = false;
+		_solverMessage = "no time left for the solver, using the greedy solution";
+		_solution = greedySolution;
+		_numEliminatedVariables -= var;
+
+		readSolution();
+		return;
+	}
+
+	if (parameters.approximation == LpRelaxation) {
+
+		solveRelaxation(objective, constraints, var, parameters.timeout, parameters.numThreads, greedySolution);
+		_numEliminatedVariables -= var;
+
+		readSolution();
+		return;
+	}
+
+	// solve
+
+	std::unique_ptr<LinearSolverBackend> solver = createSolverBackend(parameters.solverBackend);
+
+	// the in-tree solver can make use of a tighter bound that knows about the 
+	// structure of the TED ILP
+	BranchAndBoundSolver* branchAndBound = dynamic_cast<BranchAndBoundSolver*>(solver.get());
+	if (branchAndBound) {
+
+		const std::vector<double>& coefficients = objective.getCoefficients();
+		branchAndBound->setBoundFunction(
+				[this, &coefficients](const std::vector<double>& lower, const std::vector<double>& upper) {
+					return getObjectiveBound(coefficients, lower, upper);
+				});
+	}
+
+	solver->initialize(var, Binary, specialVariableTypes);
+	solver->setObjective(objective);
+	setConstraints(*solver, constraints);
+	solver->setTimeout(parameters.timeout);
+	if (parameters.numThreads > 0)
+		solver->setNumThreads(parameters.numThreads);
+
+	// the original solution is cut off by the upper bound if the greedy one 
+	// has fewer errors, the solver ignores it in this case
+	if (branchAndBound) {
+
+		branchAndBound->addStartSolution(originalSolution);
+		branchAndBound->addStartSolution(greedySolution);
+	}
+
+	_optimal = solver->solve(_solution, _solverMessage);
+
+	// fall back to the greedy solution if the solver did not find a better one
+	if (!_optimal && (
+			_solution.size() < var ||
+			getObjectiveValue(objective, _solution) > getObjectiveValue(objective, greedySolution))) {
+
+		LOG_ALL(tedcomponentlog)
+				<< "solver did not improve over the greedy solution: "
+				<< _solverMessage
+				<< std::endl;
+
+		_solution = greedySolution;
+	}
+
+	if (_optimal)
+		_lowerBound = std::round(_solution[_splits] + _solution[_merges]);
+	else if (branchAndBound)
+		_lowerBound = std::max(_lowerBound, getErrorBound(branchAndBound->getBestBound(), greedyErrors));
+
+	_numEliminatedVariables -= var;
+
+	readSolution();
+}
+
+void
+TolerantEditDistanceComponent::solveRelaxation(
+		const LinearObjective& objective,
+		const SparseConstraints& constraints,
+		unsigned int numVariables,
+		double timeout,
+		unsigned int numThreads,
+		const Solution& greedySolution) {
+
+	std::unique_ptr<LinearSolverBackend> solver = createSolverBackend(ExternalSolver);
+
+	solver->initialize(numVariables, Continuous);
+	solver->setObjective(objective);
+	setConstraints(*solver, constraints);
+	solver->setTimeout(timeout);
+	if (numThreads > 0)
+		solver->setNumThreads(numThreads);
+
+	Solution relaxed;
+	std::string message;
+
+	_optimal = false;
+
+	if (!solver->solve(relaxed, message) || relaxed.size() < numVariables) {
+
+		LOG_DEBUG(tedcomponentlog)
+				<< "LP relaxation could not be solved: " << message
+				<< std::endl;
+
+		_solverMessage = "LP relaxation could not be solved (" + message + "), using the greedy solution";
+		_solution = greedySolution;
+		return;
+	}
+
+	unsigned int greedyErrors = greedySolution[_splits] + greedySolution[_merges];
+
+	_lowerBound = std::max(_lowerBound, getErrorBound(getObjectiveValue(objective, relaxed), greedyErrors));
+
+	// every cell takes the label with the largest value, cheaper changes 
+	// first, and the result is improved greedily
+
+	const std::vector<double>& coefficients = objective.getCoefficients();
+
+	std::vector<unsigned int> choices;
+	for (unsigned int i = 0; i < _ambiguousCells.size(); i++) {
+
+		unsigned int best = _firstIndicatorVars[i];
+
+		for (unsigned int var = _firstIndicatorVars[i] + 1; var < _firstIndicatorVars[i + 1]; var++)
+			if (relaxed[var] > relaxed[best] + 1e-6 ||
+			    (relaxed[var] > relaxed[best] - 1e-6 && coefficients[var] < coefficients[best]))
+				best = var;
+
+		choices.push_back(best);
+	}
+
+	improveGreedily(choices, coefficients);
+	sortIdenticalChoices(choices);
+
+	Solution rounded = createSolution(choices, numVariables);
+
+	if (getObjectiveValue(objective, rounded) <= getObjectiveValue(objective, greedySolution))
+		_solution = rounded;
+	else
+		_solution = greedySolution;
+
+	unsigned int numErrors = _solution[_splits] + _solution[_merges];
+
+	_optimal = (numErrors <= _lowerBound);
+	_solverMessage =
+			"rounded LP relaxation has " + std::to_string(numErrors) +
+			" errors, lower bound is " + std::to_string(_lowerBound);
+}
+
+void
+TolerantEditDistanceComponent::solveGreedily(
+		const std::vector<unsigned int>& startChoices,
+		const std::vector<double>& changeCosts) {
+
+	std::vector<unsigned int> choices = startChoices;
+	improveGreedily(choices, changeCosts);
+
+	_solution = Solution(_numIndicatorVars);
+	for (unsigned int var : choices)
+		_solution[var] = 1;
+
+	// count the errors of the greedy solution, to see whether it is optimal
+	readSolution();
+	unsigned int numErrors = _numSplits + _numMerges;
+
+	std::vector<double> lower(_numIndicatorVars, 0);
+	std::vector<double> upper(_numIndicatorVars, 1);
+	_lowerBound = getErrorBound(getObjectiveBound(changeCosts, lower, upper), numErrors);
+
+	_optimal = (numErrors <= _lowerBound);
+	_solverMessage =
+			"greedy solution has " + std::to_string(numErrors) +
+			" errors, lower bound is " + std::to_string(_lowerBound);
+}
+
+double
+TolerantEditDistanceComponent::getObjectiveBound(
+		const std::vector<double>& coefficients,
+		const std::vector<double>& lower,
+		const std::vector<double>& upper) {
+
+	// With M the set of matches, the number of splits and merges is
+	//
+	//   |M| - #GT labels + sum_{REC labels r} max(0, |M_r| - 1)
+	//
+	// >= sum_{m in M} w(m) - #GT labels - #original REC labels,
+	//
+	// where w(m) is 2 if m involves an original REC label, 1 otherwise (the 
+	// merges of the other REC labels are only bounded by 0, since they are 
+	// usually not matched at all). The 
+	// right hand side is bounded by the weights of the matches that are 
+	// present already, plus one new match for each cell in a set of cells 
+	// that are not covered by present matches and have pairwise different 
+	// possible matches.
+
+	if (_matchWeights.size() != _possibleMatches.size()) {
+
+		_matchWeights.resize(_possibleMatches.size());
+		for (unsigned int match = 0; match < _possibleMatches.size(); match++)
+			_matchWeights[match] = (_isOriginalRecLabel[_possibleMatches.getLabel(match) % _recIds.size()] ? 2 : 1);
+
+		_fixedMatchesWeight = 0;
+		for (size_t key : _fixedMatches.getLabels())
+			_fixedMatchesWeight += (_isOriginalRecLabel[key % _recIds.size()] ? 2 : 1);
+
+		_matchStamps.assign(_possibleMatches.size(), 0);
+		_stamp = 0;
+	}
+
+	// present matches get the current stamp, matches of the packed cells the 
+	// next one
+	unsigned int present = ++_stamp;
+	unsigned int packed  = ++_stamp;
+
+	double weight = _fixedMatchesWeight;
+	double changes = 0;
+
+	unsigned int numCells = _firstIndicatorVars.size() - 1;
+
+	for (unsigned int i = 0; i < numCells; i++)
+		for (unsigned int var = _firstIndicatorVars[i]; var < _firstIndicatorVars[i + 1]; var++)
+			if (lower[var] > 0.5) {
+
+				unsigned int match = _matchByVar[var];
+				if (match != DenseLabels::NoId && _matchStamps[match] != present) {
+
+					_matchStamps[match] = present;
+					weight += _matchWeights[match];
+				}
+
+				changes += coefficients[var];
+			}
+
+	for (unsigned int i = 0; i < numCells; i++) {
+
+		bool decided = false;
+		bool covered = false;
+		bool disjoint = true;
+		double minChange = std::numeric_limits<double>::infinity();
+		double minWeight = std::numeric_limits<double>::infinity();
+
+		for (unsigned int var = _firstIndicatorVars[i]; var < _firstIndicatorVars[i + 1]; var++) {
+
+			if (lower[var] > 0.5)
+				decided = true;
+
+			if (upper[var] < 0.5)
+				continue;
+
+			unsigned int match = _matchByVar[var];
+			if (match == DenseLabels::NoId || _matchStamps[match] == present)
+				covered = true;
+			else if (_matchStamps[match] == packed)
+				disjoint = false;
+			else
+				minWeight = std::min(minWeight, static_cast<double>(_matchWeights[match]));
+
+			minChange = std::min(minChange, coefficients[var]);
+		}
+
+		if (decided)
+			continue;
+
+		changes += minChange;
+
+		if (covered || !disjoint)
+			continue;
+
+		// this cell needs a new match, different from the ones of all other 
+		// packed cells
+		weight += minWeight;
+		for (unsigned int var = _firstIndicatorVars[i]; var < _firstIndicatorVars[i + 1]; var++)
+			if (upper[var] > 0.5)
+				_matchStamps[_matchByVar[var]] = packed;
+	}
+
+	unsigned int numOriginalRecLabels = std::count(_isOriginalRecLabel.begin(), _isOriginalRecLabel.end(), true);
+
+	return weight - static_cast<double>(_gtIds.size()) - numOriginalRecLabels + changes;
+}
+
+void
+TolerantEditDistanceComponent::presolve() {
+
+	_ambiguousCells.clear();
+	_cellGtIds.clear();
+
+	// assign dense ids to all labels of this component, in increasing order
+
+	std::vector<size_t> gtLabels;
+	std::vector<size_t> recLabels;
+	std::vector<size_t> originalRecLabels;
+
+	for (unsigned int cellIndex : _cellIndices) {
+
+		const Cell<size_t>& cell = _cells[cellIndex];
+
+		gtLabels.push_back(cell.getGroundTruthLabel());
+		originalRecLabels.push_back(cell.getReconstructionLabel());
+		for (size_t l : cell.getPossibleLabels())
+			recLabels.push_back(l);
+	}
+	recLabels.insert(recLabels.end(), originalRecLabels.begin(), originalRecLabels.end());
+
+	_gtIds.clear();
+	for (size_t label : sortedUnique(gtLabels))
+		_gtIds.insert(label);
+
+	_recIds.clear();
+	for (size_t label : sortedUnique(recLabels))
+		_recIds.insert(label);
+
+	_isOriginalRecLabel.assign(_recIds.size(), false);
+	for (size_t label : originalRecLabels)
+		_isOriginalRecLabel[_recIds.find(label)] = true;
+
+	_numFixedMatchesByGt.assign(_gtIds.size(), 0);
+	_numFixedMatchesByRec.assign(_recIds.size(), 0);
+	_fixedMatches.clear();
+
+	// all possible matches, to count the variables of the unreduced ILP
+	std::vector<size_t> allMatches;
+	unsigned int numIndicators = 0;
+
+	// cells with a single possible label keep it, and the match they create 
+	// is present in every solution
+	for (unsigned int i = 0; i < _cellIndices.size(); i++) {
+
+		const Cell<size_t>& cell = _cells[_cellIndices[i]];
+		unsigned int gtId = _gtIds.find(cell.getGroundTruthLabel());
+
+		_cellGtIds.push_back(gtId);
+
+		numIndicators += cell.getPossibleLabels().size();
+		for (size_t l : cell.getPossibleLabels())
+			allMatches.push_back(getMatchKey(gtId, _recIds.find(l)));
+
+		if (cell.getPossibleLabels().size() > 1) {
+
+			_ambiguousCells.push_back(i);
+			continue;
+		}
+
+		unsigned int recId = _recIds.find(cell.getReconstructionLabel());
+		size_t numFixed = _fixedMatches.size();
+
+		if (_fixedMatches.insert(getMatchKey(gtId, recId)) == numFixed) {
+
+			_numFixedMatchesByGt[gtId]++;
+			_numFixedMatchesByRec[recId]++;
+		}
+	}
+
+	// the remaining ambiguous cells can only create matches that are not fixed 
+	// already
+
+	std::vector<size_t> possibleMatches;
+	for (unsigned int i : _ambiguousCells)
+		for (size_t l : _cells[_cellIndices[i]].getPossibleLabels()) {
+
+			size_t key = getMatchKey(_cellGtIds[i], _recIds.find(l));
+
+			if (!_fixedMatches.contains(key))
+				possibleMatches.push_back(key);
+		}
+
+	_possibleMatches.clear();
+	_possibleMatchesByGt.assign(_gtIds.size(), std::vector<unsigned int>());
+	_possibleMatchesByRec.assign(_recIds.size(), std::vector<unsigned int>());
+
+	for (size_t key : sortedUnique(possibleMatches)) {
+
+		unsigned int match = _possibleMatches.insert(key);
+
+		_possibleMatchesByGt[key/_recIds.size()].push_back(match);
+		_possibleMatchesByRec[key%_recIds.size()].push_back(match);
+	}
+
+	// indicators, matches, splits per GT label, merges per REC label, and 
+	// the two totals
+	_numEliminatedVariables =
+			numIndicators +
+			sortedUnique(allMatches).size() +
+			_gtIds.size() + 1 +
+			_recIds.size() + 1;
+}
+
+void
+TolerantEditDistanceComponent::findIdenticalCells() {
+
+	auto isLess = [this](unsigned int i, unsigned int j) {
+
+		const Cell<size_t>& a = _cells[_cellIndices[_ambiguousCells[i]]];
+		const Cell<size_t>& b = _cells[_cellIndices[_ambiguousCells[j]]];
+
+		if (_cellGtIds[_ambiguousCells[i]] != _cellGtIds[_ambiguousCells[j]])
+			return _cellGtIds[_ambiguousCells[i]] < _cellGtIds[_ambiguousCells[j]];
+		if (a.getReconstructionLabel() != b.getReconstructionLabel())
+			return a.getReconstructionLabel() < b.getReconstructionLabel();
+		if (a.size() != b.size())
+			return a.size() < b.size();
+
+		return std::lexicographical_compare(
+				a.getPossibleLabels().begin(), a.getPossibleLabels().end(),
+				b.getPossibleLabels().begin(), b.getPossibleLabels().end());
+	};
+
+	std::vector<unsigned int> order(_ambiguousCells.size());
+	for (unsigned int i = 0; i < order.size(); i++)
+		order[i] = i;
+	std::stable_sort(order.begin(), order.end(), isLess);
+
+	for (unsigned int k = 0; k < order.size(); k++) {
+
+		if (k == 0 || isLess(order[k - 1], order[k]))
+			_identicalCells.push_back(std::vector<unsigned int>());
+
+		_identicalCells.back().push_back(order[k]);
+	}
+
+	// only groups with more than one cell are of interest
+	_identicalCells.erase(
+			std::remove_if(
+					_identicalCells.begin(),
+					_identicalCells.end(),
+					[](const std::vector<unsigned int>& group) { return group.size() < 2; }),
+			_identicalCells.end());
+
+	LOG_ALL(tedcomponentlog)
+			<< "found " << _identicalCells.size() << " groups of identical cells"
+			<< std::endl;
+}
+
+void
+TolerantEditDistanceComponent::sortIdenticalChoices(std::vector<unsigned int>& choices) {
+
+	for (const std::vector<unsigned int>& group : _identicalCells) {
+
+		std::vector<unsigned int> positions;
+		for (unsigned int i : group)
+			positions.push_back(choices[i] - _firstIndicatorVars[i]);
+		std::sort(positions.begin(), positions.end());
+
+		for (unsigned int k = 0; k < group.size(); k++)
+			choices[group[k]] = _firstIndicatorVars[group[k]] + positions[k];
+	}
+}
+
+void
+TolerantEditDistanceComponent::improveGreedily(
+		std::vector<unsigned int>& choices,
+		const std::vector<double>& coefficients) {
+
+	unsigned int numCells = _ambiguousCells.size();
+
+	std::vector<unsigned int> recIdByVar(_numIndicatorVars);
+	for (unsigned int var = 0; var < _numIndicatorVars; var++)
+		recIdByVar[var] = _recIds.find(_labelingByVar[var].second);
+
+	// the number of ambiguous cells that create each possible match, and the 
+	// number of present matches by ground truth and reconstruction id
+	std::vector<unsigned int> numCellsByMatch(_possibleMatches.size(), 0);
+	std::vector<unsigned int> numMatchesByGt(_numFixedMatchesByGt);
+	std::vector<unsigned int> numMatchesByRec(_numFixedMatchesByRec);
+
+	auto addVar = [&](unsigned int var) {
+
+		unsigned int match = _matchByVar[var];
+		if (match != DenseLabels::NoId && numCellsByMatch[match]++ == 0) {
+
+			size_t key = _possibleMatches.getLabel(match);
+			numMatchesByGt[key/_recIds.size()]++;
+			numMatchesByRec[key%_recIds.size()]++;
+		}
+	};
+
+	auto removeVar = [&](unsigned int var) {
+
+		unsigned int match = _matchByVar[var];
+		if (match != DenseLabels::NoId && --numCellsByMatch[match] == 0) {
+
+			size_t key = _possibleMatches.getLabel(match);
+			numMatchesByGt[key/_recIds.size()]--;
+			numMatchesByRec[key%_recIds.size()]--;
+		}
+	};
+
+	// the splits of a ground truth label and the merges of up to two 
+	// reconstruction labels
+	auto getErrors = [&](unsigned int gtId, unsigned int recId1, unsigned int recId2) {
+
+		int errors = std::max<int>(0, static_cast<int>(numMatchesByGt[gtId]) - 1);
+		errors += std::max<int>(0, static_cast<int>(numMatchesByRec[recId1]) - 1);
+		if (recId2 != recId1)
+			errors += std::max<int>(0, static_cast<int>(numMatchesByRec[recId2]) - 1);
+		return errors;
+	};
+
+	for (unsigned int var : choices)
+		addVar(var);
+
+	std::vector<unsigned int> order(numCells);
+	for (unsigned int i = 0; i < numCells; i++)
+		order[i] = i;
+	std::stable_sort(
+			order.begin(),
+			order.end(),
+			[this](unsigned int a, unsigned int b) {
+				return _cells[_cellIndices[_ambiguousCells[a]]].size() > _cells[_cellIndices[_ambiguousCells[b]]].size();
+			});
+
+	// every accepted relabeling decreases the objective, such that this 
+	// terminates
+	bool improved = true;
+	while (improved) {
+
+		improved = false;
+
+		for (unsigned int i : order) {
+
+			unsigned int current = choices[i];
+			unsigned int gtId = _cellGtIds[_ambiguousCells[i]];
+
+			unsigned int best = current;
+			double bestDelta = 0;
+
+			for (unsigned int var = _firstIndicatorVars[i]; var < _firstIndicatorVars[i + 1]; var++) {
+
+				if (var == current)
+					continue;
+
+				int before = getErrors(gtId, recIdByVar[current], recIdByVar[var]);
+				removeVar(current);
+				addVar(var);
+				int after = getErrors(gtId, recIdByVar[current], recIdByVar[var]);
+				removeVar(var);
+				addVar(current);
+
+				double delta = (after - before) + coefficients[var] - coefficients[current];
+
+				if (delta < bestDelta) {
+
+					best = var;
+					bestDelta = delta;
+				}
+			}
+
+			if (best != current) {
+
+				removeVar(current);
+				addVar(best);
+				choices[i] = best;
+				improved = true;
+			}
+		}
+	}
+}
+
+Solution
+TolerantEditDistanceComponent::createSolution(
+		const std::vector<unsigned int>& choices,
+		unsigned int numVariables) {
+
+	Solution solution(numVariables);
+
+	for (unsigned int var : choices)
+		solution[var] = 1;
+
+	std::vector<unsigned int> numMatchesByGt(_numFixedMatchesByGt);
+	std::vector<unsigned int> numMatchesByRec(_numFixedMatchesByRec);
+
+	for (unsigned int match = 0; match < _possibleMatches.size(); match++)
+		for (unsigned int var : _indicatorVarsByMatch[match])
+			if (solution[var] > 0.5) {
+
+				solution[_firstMatchVar + match] = 1;
+
+				size_t key = _possibleMatches.getLabel(match);
+				numMatchesByGt[key/_recIds.size()]++;
+				numMatchesByRec[key%_recIds.size()]++;
+				break;
+			}
+
+	unsigned int numSplits = 0;
+	for (unsigned int gtId = 0; gtId < _gtIds.size(); gtId++)
+		if (numMatchesByGt[gtId] > 0)
+			numSplits += numMatchesByGt[gtId] - 1;
+
+	unsigned int numMerges = 0;
+	for (unsigned int recId = 0; recId < _recIds.size(); recId++)
+		if (numMatchesByRec[recId] > 0)
+			numMerges += numMatchesByRec[recId] - 1;
+
+	for (const auto& p : _splitVars)
+		solution[p.second] = std::max<int>(0, static_cast<int>(numMatchesByGt[p.first]) - 1);
+	for (const auto& p : _mergeVars)
+		solution[p.second] = std::max<int>(0, static_cast<int>(numMatchesByRec[p.first]) - 1);
+
+	solution[_splits] = numSplits;
+	solution[_merges] = numMerges;
+
+	return solution;
+}
+
+std::vector<size_t>
+TolerantEditDistanceComponent::sortedUnique(std::vector<size_t> values) {
+
+	std::sort(values.begin(), values.end());
+	values.erase(std::unique(values.begin(), values.end()), values.end());
+
+	return values;
+}
+
+void
+TolerantEditDistanceComponent::readSolution() {
+
+	// start from the original labels, which are always a feasible solution
+	_cellLabels.resize(_cellIndices.size());
+	for (unsigned int i = 0; i < _cellIndices.size(); i++)
+		_cellLabels[i] = _cells[_cellIndices[i]].getReconstructionLabel();
+
+	if (_solution.size() >= _numIndicatorVars) {
+
+		for (unsigned int i = 0; i < _numIndicatorVars; i++)
+			if (_solution[i] > 0.5)
+				_cellLabels[_labelingByVar[i].first] = _labelingByVar[i].second;
+
+	} else {
+
+		LOG_ERROR(tedcomponentlog)
+				<< "no solution found for component, keeping original labels"
+				<< std::endl;
+	}
+
+	// count splits and merges of the final labeling
+
+	std::vector<size_t> matches;
+	for (unsigned int i = 0; i < _cellIndices.size(); i++)
+		matches.push_back(getMatchKey(_cellGtIds[i], _recIds.find(_cellLabels[i])));
+	matches = sortedUnique(matches);
+
+	std::vector<unsigned int> numMatchesByGt(_gtIds.size(), 0);
+	std::vector<unsigned int> numMatchesByRec(_recIds.size(), 0);
+	for (size_t key : matches) {
+
+		numMatchesByGt[key/_recIds.size()]++;
+		numMatchesByRec[key%_recIds.size()]++;
+	}
+
+	_numSplits = 0;
+	_numMerges = 0;
+	for (unsigned int n : numMatchesByGt)
+		if (n > 0)
+			_numSplits += n - 1;
+	for (unsigned int n : numMatchesByRec)
+		if (n > 0)
+			_numMerges += n - 1;
+}
@@ -0,0 +1,354 @@
+#ifndef TED_EVALUATION_TOLERANT_EDIT_DISTANCE_COMPONENT_H__
+#define TED_EVALUATION_TOLERANT_EDIT_DISTANCE_COMPONENT_H__
+
+#include <string>
+#include <vector>
+
+#include <inference/LinearObjective.h>
+#include <inference/Solution.h>
+#include "Cells.h"
+#include "DenseLabels.h"
+#include "SolverBackend.h"
+#include "SparseConstraints.h"
+
+/**
+ * A connected component of the graph of possible matches between ground truth
+ * and reconstruction labels. Two labels are connected, if there is a cell with
+ * the ground truth label that can take the reconstruction label. Cells of
+ * different components never share a ground truth or reconstruction label,
+ * such that the TED ILP can be solved for each component independently.
+ */
+class TolerantEditDistanceComponent {
+
+public:
+
+	/**
+	 * How to solve the ILP of a component.
+	 */
+	enum Approximation {
+
+		/**
+		 * Solve the ILP exactly, within the timeout.
+		 */
+		Exact,
+
+		/**
+		 * Solve the LP relaxation and round it to a labeling. The LP gives a 
+		 * lower bound on the number of errors.
+		 */
+		LpRelaxation,
+
+		/**
+		 * Visit the ambiguous cells in order of decreasing size and relabel 
+		 * each one if that reduces the number of errors, until no single 
+		 * relabeling helps anymore. Does not build an ILP.
+		 */
+		Greedy
+	};
+
+	/**
+	 * How to formulate the ILP of a component.
+	 */
+	enum Formulation {
+
+		/**
+		 * One row for each indicator to activate its match, and one split 
+		 * and merge variable for each label with undecided matches.
+		 */
+		Standard,
+
+		/**
+		 * One aggregated row to activate each match, split and merge 
+		 * variables only where the number of matches can drop to zero, and 
+		 * symmetry breaking constraints between interchangeable cells.
+		 */
+		Compact
+	};
+
+	struct Parameters {
+
+		Parameters() :
+			timeout(0),
+			numThreads(0),
+			solverBackend(ExternalSolver),
+			approximation(Exact),
+			formulation(Standard) {}
+
+		/**
+		 * Timeout for the solver in seconds. 0 for no limit, negative to skip 
+		 * the solver and keep the greedy solution.
+		 */
+		double timeout;
+
+		/**
+		 * The number of threads the solver backend may use. 0 for the 
+		 * default of the backend. Should be 1 if several components are 
+		 * solved concurrently.
+		 */
+		unsigned int numThreads;
+
+		/**
+		 * The linear solver backend to use. The LP relaxation is always 
+		 * solved with an external solver.
+		 */
+		SolverBackend solverBackend;
+
+		/**
+		 * Whether and how to approximate the solution.
+		 */
+		Approximation approximation;
+
+		/**
+		 * How to formulate the ILP.
+		 */
+		Formulation formulation;
+	};
+
+	/**
+	 * Create a component from a subset of the given cells.
+	 *
+	 * @param cells
+	 *             The list of all cells. Has to outlive this object.
+	 * @param cellIndices
+	 *             The indices of the cells that form this component.
+	 */
+	TolerantEditDistanceComponent(
+			const Cells& cells,
+			const std::vector<unsigned int>& cellIndices);
+
+	/**
+	 * Set a labeling to start the search from, e.g., the solution for a 
+	 * smaller distance threshold. Labels that are not possible for a cell are 
+	 * ignored, the original label is used instead.
+	 *
+	 * @param cellLabels
+	 *             A label for each of the cells, not only the ones of this 
+	 *             component.
+	 */
+	void setStartLabels(const std::vector<size_t>& cellLabels);
+
+	/**
+	 * Build and solve the ILP of this component. Safe to be called
+	 * concurrently on different components.
+	 */
+	void solve(const Parameters& parameters = Parameters());
+
+	/**
+	 * Get the indices of the cells in this component.
+	 */
+	const std::vector<unsigned int>& getCellIndices() const { return _cellIndices; }
+
+	/**
+	 * After solve(), get the reconstruction label assigned to the i-th cell of
+	 * this component.
+	 */
+	size_t getCellLabel(unsigned int i) const { return _cellLabels[i]; }
+
+	/**
+	 * After solve(), get the number of splits and merges in this component.
+	 */
+	unsigned int getNumSplits() const { return _numSplits; }
+	unsigned int getNumMerges() const { return _numMerges; }
+
+	/**
+	 * After solve(), get a lower bound on the number of splits and merges in 
+	 * this component. Equal to the number of errors if the solution is 
+	 * optimal.
+	 */
+	unsigned int getLowerBound() const { return _lowerBound; }
+
+	/**
+	 * After solve(), get the number of variables in the ILP of this component.
+	 */
+	unsigned int getNumVariables() const { return _solution.size(); }
+
+	/**
+	 * After solve(), get the number of constraints and of non-zero 
+	 * coefficients in the constraints of the ILP of this component.
+	 */
+	unsigned int getNumConstraints() const { return _numConstraints; }
+	size_t getNumNonZeros() const { return _numNonZeros; }
+
+	/**
+	 * After solve(), get the number of variables that did not have to be 
+	 * passed to the solver, since their values are determined by cells with a 
+	 * single possible label.
+	 */
+	unsigned int getNumEliminatedVariables() const { return _numEliminatedVariables; }
+
+	/**
+	 * After solve(), check whether the solver found an optimal solution. If
+	 * not, the best solution found is used.
+	 */
+	bool isOptimal() const { return _optimal; }
+
+	/**
+	 * After solve(), get the message of the solver.
+	 */
+	const std::string& getSolverMessage() const { return _solverMessage; }
+
+private:
+
+	// fix the labels of cells with a single possible label and collect the 
+	// ambiguous cells and undecided matches that are left for the solver
+	void presolve();
+
+	// pack a pair of ground truth and reconstruction label ids into one key
+	size_t getMatchKey(unsigned int gtId, unsigned int recId) const {
+
+		return static_cast<size_t>(gtId)*_recIds.size() + recId;
+	}
+
+	void readSolution();
+
+	// find a solution with improveGreedily(), starting from the original 
+	// labeling or the start labels
+	void solveGreedily(
+			const std::vector<unsigned int>& startChoices,
+			const std::vector<double>& changeCosts);
+
+	// solve the LP relaxation of the given ILP, and round it to a labeling
+	void solveRelaxation(
+			const LinearObjective& objective,
+			const SparseConstraints& constraints,
+			unsigned int numVariables,
+			double timeout,
+			unsigned int numThreads,
+			const Solution& greedySolution);
+
+	// find groups of ambiguous cells that are interchangeable in the ILP, 
+	// since they have the same ground truth label, original label, size, and 
+	// possible labels
+	void findIdenticalCells();
+
+	// reorder the chosen labels within each group of identical cells, such 
+	// that they satisfy the symmetry breaking constraints
+	void sortIdenticalChoices(std::vector<unsigned int>& choices);
+
+	// relabel single ambiguous cells as long as this reduces the objective, 
+	// visiting larger cells first
+	//
+	// @param choices
+	//             The chosen indicator variable of each ambiguous cell, to be 
+	//             improved.
+	void improveGreedily(
+			std::vector<unsigned int>& choices,
+			const std::vector<double>& coefficients);
+
+	// create an ILP solution from the chosen indicator variable of each 
+	// ambiguous cell
+	Solution createSolution(
+			const std::vector<unsigned int>& choices,
+			unsigned int numVariables);
+
+	// a lower bound of the objective for the indicator variables within the 
+	// given bounds
+	double getObjectiveBound(
+			const std::vector<double>& coefficients,
+			const std::vector<double>& lower,
+			const std::vector<double>& upper);
+
+	static std::vector<size_t> sortedUnique(std::vector<size_t> values);
+
+	const Cells& _cells;
+
+	std::vector<unsigned int> _cellIndices;
+
+	// the label of each cell to start from, empty for the original labeling
+	std::vector<size_t> _startLabels;
+
+	// dense ids for all labels of the cells in this component, in increasing 
+	// label order
+	DenseLabels _gtIds;
+	DenseLabels _recIds;
+
+	// whether a reconstruction label is the original label of a cell, by id, 
+	// for the lower bound
+	std::vector<char> _isOriginalRecLabel;
+
+	// the ground truth label id of each cell
+	std::vector<unsigned int> _cellGtIds;
+
+	// positions in _cellIndices of cells with more than one possible label
+	std::vector<unsigned int> _ambiguousCells;
+
+	// matches that are present in every solution, since they are created by 
+	// cells with a single possible label, as match keys
+	DenseLabels _fixedMatches;
+
+	// the number of fixed matches, by ground truth and reconstruction id
+	std::vector<unsigned int> _numFixedMatchesByGt;
+	std::vector<unsigned int> _numFixedMatchesByRec;
+
+	// matches that depend on the labels of the ambiguous cells, as match keys 
+	// in increasing order
+	DenseLabels _possibleMatches;
+
+	// the possible matches of each ground truth and reconstruction id
+	std::vector<std::vector<unsigned int>> _possibleMatchesByGt;
+	std::vector<std::vector<unsigned int>> _possibleMatchesByRec;
+
+	// the number of variables removed by presolve()
+	unsigned int _numEliminatedVariables;
+
+	// indicator variables by possible match
+	std::vector<std::vector<unsigned int>> _indicatorVarsByMatch;
+
+	// (position in _cellIndices, new label) by indicator variable
+	std::vector<std::pair<unsigned int, size_t>> _labelingByVar;
+
+	// the first indicator variable of each ambiguous cell, and the end of the 
+	// indicator variables
+	std::vector<unsigned int> _firstIndicatorVars;
+
+	// groups of identical ambiguous cells, as positions in _ambiguousCells, 
+	// for the compact formulation
+	std::vector<std::vector<unsigned int>> _identicalCells;
+
+	// the possible match of each indicator variable, NoId if the match is 
+	// fixed
+	std::vector<unsigned int> _matchByVar;
+
+	// for getLowerBound(), the weight of each possible match and of all fixed 
+	// matches, and stamps to mark matches
+	std::vector<char> _matchWeights;
+	double _fixedMatchesWeight;
+	std::vector<unsigned int> _matchStamps;
+	unsigned int _stamp;
+
+	// the ILP variable of the first possible match, the others follow in order
+	unsigned int _firstMatchVar;
+
+	// the number of indicator variables in the ILP
+	unsigned int _numIndicatorVars;
+
+	// indicators for alternative cell labels, and the corresponding cell size
+	std::vector<std::pair<unsigned int, size_t> > _alternativeIndicators;
+
+	// (ground truth id, variable) of the split number variables, and 
+	// (reconstruction id, variable) of the merge number variables
+	std::vector<std::pair<unsigned int, unsigned int>> _splitVars;
+	std::vector<std::pair<unsigned int, unsigned int>> _mergeVars;
+
+	// the ILP variables for the number of splits and merges
+	unsigned int _splits;
+	unsigned int _merges;
+
+	// the size of the ILP
+	unsigned int _numConstraints;
+	size_t _numNonZeros;
+
+	// the solution of the ILP
+	Solution _solution;
+	bool _optimal;
+	std::string _solverMessage;
+
+	// the result for each cell of this component
+	std::vector<size_t> _cellLabels;
+	unsigned int _numSplits;
+	unsigned int _numMerges;
+	unsigned int _lowerBound;
+};
+
+#endif // TED_EVALUATION_TOLERANT_EDIT_DISTANCE_COMPONENT_H__
+
@@ -1,15 +1,23 @@
+#include <algorithm>
 #include <queue>
 #include <boost/timer/timer.hpp>
 #include <boost/range/adaptors.hpp>
 #include <util/exceptions.h>
 #include <util/Logger.h>
 #include "TolerantEditDistanceErrors.h"
+#include "SurfaceSpanningTree.h"
+#include "Parallel.h"
 
 logger::LogChannel errorslog("errorslog", "[TolerantEditDistanceErrors] ");
 
 TolerantEditDistanceErrors::TolerantEditDistanceErrors() :
 	_haveBackgroundLabel(false),
-	_dirty(true) {
+	_dirty(true),
+	_lowerBound(0),
+	_numEliminatedVariables(0),
+	_numConstraints(0),
+	_numNonZeros(0),
+	_numThreads(0) {
 
 	clear();
 
@@ -20,7 +28,12 @@ TolerantEditDistanceErrors::TolerantEditDistanceErrors(size_t gtBackgroundLabel,
 	_haveBackgroundLabel(true),
 	_gtBackgroundLabel(gtBackgroundLabel),
 	_recBackgroundLabel(recBackgroundLabel),
-	_dirty(true) {
+	_dirty(true),
+	_lowerBound(0),
+	_numEliminatedVariables(0),
+	_numConstraints(0),
+	_numNonZeros(0),
+	_numThreads(0) {
 
 	clear();
 
@@ -37,8 +50,13 @@ TolerantEditDistanceErrors::setCells(std::shared_ptr<Cells> cells) {
 void
 TolerantEditDistanceErrors::clear() {
 
-	_cellsByGtToRecLabel.clear();
-	_cellsByRecToGtLabel.clear();
+	_gt.clear();
+	_rec.clear();
+	_matchIds.clear();
+	_gtIdByMatch.clear();
+	_recIdByMatch.clear();
+	_cellsByMatch.clear();
+	_overlapByMatch.clear();
 
 	_dirty = true;
 }
@@ -49,10 +67,39 @@ TolerantEditDistanceErrors::addMapping(unsigned int cellIndex, size_t recLabel)
 	if (!_cells)
 		BOOST_THROW_EXCEPTION(UsageError() << error_message("cells need to be set before using addMapping()") << STACK_TRACE);
 
-	size_t gtLabel = (*_cells)[cellIndex].getGroundTruthLabel();
+	unsigned int gtId  = getLabelId(_gt, (*_cells)[cellIndex].getGroundTruthLabel());
+	unsigned int recId = getLabelId(_rec, recLabel);
 
-	addEntry(_cellsByRecToGtLabel, recLabel, gtLabel, cellIndex);
-	addEntry(_cellsByGtToRecLabel, gtLabel, recLabel, cellIndex);
+	size_t numMatches = _matchIds.size();
+	unsigned int match = _matchIds.insert(getMatchKey(gtId, recId));
+
+	if (match == numMatches) {
+
+		_gtIdByMatch.push_back(gtId);
+		_recIdByMatch.push_back(recId);
+		_cellsByMatch.push_back(std::vector<unsigned int>());
+		_overlapByMatch.push_back(0);
+		_gt.matches[gtId].push_back(match);
+		_rec.matches[recId].push_back(match);
+	}
+
+	// keep the cells of each match sorted and unique, cells are usually added 
+	// in increasing order
+	std::vector<unsigned int>& cells = _cellsByMatch[match];
+	if (cells.empty() || cells.back() < cellIndex) {
+
+		cells.push_back(cellIndex);
+
+	} else {
+
+		auto i = std::lower_bound(cells.begin(), cells.end(), cellIndex);
+		if (*i == cellIndex)
+			return;
+
+		cells.insert(i, cellIndex);
+	}
+
+	_overlapByMatch[match] += (*_cells)[cellIndex].size();
 
 	_dirty = true;
 }
@@ -62,7 +109,11 @@ TolerantEditDistanceErrors::getReconstructionLabels(size_t gtLabel) {
 
 	std::vector<size_t> recLabels;
 
-	for (auto& p : _cellsByGtToRecLabel[gtLabel])
+	unsigned int gtId = _gt.ids.find(gtLabel);
+	if (gtId == DenseLabels::NoId)
+		return recLabels;
+
+	for (const auto& p : getPartners(_gt, gtId, _rec, _recIdByMatch))
 		recLabels.push_back(p.first);
 
 	return recLabels;
@@ -73,7 +124,11 @@ TolerantEditDistanceErrors::getGroundTruthLabels(size_t recLabel) {
 
 	std::vector<size_t> gtLabels;
 
-	for (auto& p : _cellsByRecToGtLabel[recLabel])
+	unsigned int recId = _rec.ids.find(recLabel);
+	if (recId == DenseLabels::NoId)
+		return gtLabels;
+
+	for (const auto& p : getPartners(_rec, recId, _gt, _gtIdByMatch))
 		gtLabels.push_back(p.first);
 
 	return gtLabels;
@@ -84,18 +139,21 @@ TolerantEditDistanceErrors::getMatches() {
 
 	std::vector<Match> matches;
 
-	for (auto& p_gt : _cellsByGtToRecLabel) {
+	// report in increasing order of ground truth and reconstruction labels
 
-		size_t gt_label = p_gt.first;
+	std::vector<std::pair<size_t, unsigned int>> gtLabels;
+	for (unsigned int gtId = 0; gtId < _gt.ids.size(); gtId++)
+		gtLabels.push_back(std::make_pair(_gt.ids.getLabel(gtId), gtId));
+	std::sort(gtLabels.begin(), gtLabels.end());
 
-		for (auto& p_rec : p_gt.second) {
+	for (const auto& p_gt : gtLabels) {
 
-			size_t rec_label = p_rec.first;
+		for (const auto& p_rec : getPartners(_gt, p_gt.second, _rec, _recIdByMatch)) {
 
 			Match match;
-			match.gtLabel = gt_label;
-			match.recLabel = rec_label;
-			match.overlap = getOverlap(gt_label, rec_label);
+			match.gtLabel = p_gt.first;
+			match.recLabel = p_rec.first;
+			match.overlap = getMatchSize(p_rec.second);
 			matches.push_back(match);
 		}
 	}
@@ -109,14 +167,18 @@ TolerantEditDistanceErrors::getOverlap(size_t gtLabel, size_t recLabel) {
 	if (!_cells)
 		BOOST_THROW_EXCEPTION(UsageError() << error_message("cells need to be set before using getOverlap()") << STACK_TRACE);
 
-	if (_cellsByGtToRecLabel.count(gtLabel) == 0 || _cellsByGtToRecLabel[gtLabel].count(recLabel) == 0)
+	unsigned int gtId  = _gt.ids.find(gtLabel);
+	unsigned int recId = _rec.ids.find(recLabel);
+
+	if (gtId == DenseLabels::NoId || recId == DenseLabels::NoId)
 		return 0;
 
-	unsigned int overlap = 0;
-	for (unsigned int cellIndex : _cellsByGtToRecLabel[gtLabel][recLabel])
-		overlap += (*_cells)[cellIndex].size();
+	unsigned int match = _matchIds.find(getMatchKey(gtId, recId));
 
-	return overlap;
+	if (match == DenseLabels::NoId)
+		return 0;
+
+	return getMatchSize(match);
 }
 
 unsigned int
@@ -153,9 +215,9 @@ TolerantEditDistanceErrors::getMergeLabels() {
 	updateErrorCounts();
 
 	std::set<size_t> mergeLabels;
-	for (auto& p : _merges)
-		if (!_haveBackgroundLabel || p.first != _recBackgroundLabel)
-			mergeLabels.insert(p.first);
+	for (unsigned int recId : _rec.splits)
+		if (!_haveBackgroundLabel || _rec.ids.getLabel(recId) != _recBackgroundLabel)
+			mergeLabels.insert(_rec.ids.getLabel(recId));
 	return mergeLabels;
 }
 
@@ -165,9 +227,9 @@ TolerantEditDistanceErrors::getSplitLabels() {
 	updateErrorCounts();
 
 	std::set<size_t> splitLabels;
-	for (auto& p : _splits)
-		if (!_haveBackgroundLabel || p.first != _gtBackgroundLabel)
-			splitLabels.insert(p.first);
+	for (unsigned int gtId : _gt.splits)
+		if (!_haveBackgroundLabel || _gt.ids.getLabel(gtId) != _gtBackgroundLabel)
+			splitLabels.insert(_gt.ids.getLabel(gtId));
 	return splitLabels;
 }
 
@@ -223,146 +285,237 @@ TolerantEditDistanceErrors::getFalseNegatives() {
 	return mergeLabels;
 }
 
-const TolerantEditDistanceErrors::cell_map_t::mapped_type&
+TolerantEditDistanceErrors::cell_map_t
 TolerantEditDistanceErrors::getSplitCells(size_t gtLabel) {
 
 	updateErrorCounts();
-	return _splits[gtLabel];
+	return getPartnerCells(_gt, gtLabel, _rec, _recIdByMatch);
 }
 
-const TolerantEditDistanceErrors::cell_map_t::mapped_type&
+TolerantEditDistanceErrors::cell_map_t
 TolerantEditDistanceErrors::getMergeCells(size_t recLabel) {
 
 	updateErrorCounts();
-	return _merges[recLabel];
+	return getPartnerCells(_rec, recLabel, _gt, _gtIdByMatch);
 }
 
-const TolerantEditDistanceErrors::cell_map_t::mapped_type&
+TolerantEditDistanceErrors::cell_map_t
 TolerantEditDistanceErrors::getFalsePositiveCells() {
 
 	if (!_haveBackgroundLabel)
 		BOOST_THROW_EXCEPTION(UsageError() << error_message("we don't have a background label -- cannot give false positives"));
 
 	updateErrorCounts();
-	return _splits[_gtBackgroundLabel];
+	return getPartnerCells(_gt, _gtBackgroundLabel, _rec, _recIdByMatch);
 }
 
-const TolerantEditDistanceErrors::cell_map_t::mapped_type&
+TolerantEditDistanceErrors::cell_map_t
 TolerantEditDistanceErrors::getFalseNegativeCells() {
 
 	if (!_haveBackgroundLabel)
 		BOOST_THROW_EXCEPTION(UsageError() << error_message("we don't have a background label -- cannot give false negatives"));
 
 	updateErrorCounts();
-	return _merges[_recBackgroundLabel];
+	return getPartnerCells(_rec, _recBackgroundLabel, _gt, _gtIdByMatch);
 }
 
 std::vector<TolerantEditDistanceErrors::SplitError>
 TolerantEditDistanceErrors::getSplitErrors() {
 
 	LOG_DEBUG(errorslog) << "getting split errors (X=GT, Y=REC)" << std::endl;
-	return getGenericSplitErrors<SplitError>(_splits, _cellsByGtToRecLabel);
+
+	updateErrorCounts();
+	return getGenericSplitErrors<SplitError>(_gt, _rec, _recIdByMatch);
 }
 
 std::vector<TolerantEditDistanceErrors::MergeError>
 TolerantEditDistanceErrors::getMergeErrors() {
 
 	LOG_DEBUG(errorslog) << "getting split errors (X=REC, Y=GR)" << std::endl;
-	return getGenericSplitErrors<MergeError>(_merges, _cellsByRecToGtLabel);
+
+	updateErrorCounts();
+	return getGenericSplitErrors<MergeError>(_rec, _gt, _gtIdByMatch);
+}
+
+void
+TolerantEditDistanceErrors::getSplitAndMergeErrors(
+		std::vector<SplitError>& splitErrors,
+		std::vector<MergeError>& mergeErrors) {
+
+	LOG_DEBUG(errorslog) << "getting split and merge errors" << std::endl;
+
+	updateErrorCounts();
+
+	std::vector<unsigned int> splits = getSortedSplits(_gt);
+	std::vector<unsigned int> merges = getSortedSplits(_rec);
+
+	std::vector<unsigned int> splitOrder = getProcessingOrder(_gt, splits);
+	std::vector<unsigned int> mergeOrder = getProcessingOrder(_rec, merges);
+
+	// one pool for the labels of both sides, merges after splits
+	std::vector<std::vector<SplitError>> labelSplitErrors(splits.size());
+	std::vector<std::vector<MergeError>> labelMergeErrors(merges.size());
+
+	parallelFor(
+			splits.size() + merges.size(),
+			_numThreads,
+			[&](size_t j) {
+
+				if (j < splits.size()) {
+
+					unsigned int i = splitOrder[j];
+					labelSplitErrors[i] = getLabelSplitErrors<SplitError>(_gt, splits[i], _rec, _recIdByMatch);
+
+				} else {
+
+					unsigned int i = mergeOrder[j - splits.size()];
+					labelMergeErrors[i] = getLabelSplitErrors<MergeError>(_rec, merges[i], _gt, _gtIdByMatch);
+				}
+			});
+
+	splitErrors.clear();
+	for (const std::vector<SplitError>& errors : labelSplitErrors)
+		splitErrors.insert(splitErrors.end(), errors.begin(), errors.end());
+
+	mergeErrors.clear();
+	for (const std::vector<MergeError>& errors : labelMergeErrors)
+		mergeErrors.insert(mergeErrors.end(), errors.begin(), errors.end());
 }
 
 template <typename ErrorType>
 std::vector<ErrorType>
 TolerantEditDistanceErrors::getGenericSplitErrors(
-		cell_map_t& splits,
-		cell_map_t& cellsByGtToRecLabel) {
-
-	std::vector<ErrorType> mstSplitErrors;
+		const Side& side,
+		const Side& partners,
+		const std::vector<unsigned int>& partnerIdByMatch) {
 
 	LOG_DEBUG(errorslog) << "searching for error locations and sizes..." << std::endl;
 
-	// for every GT label
-	for (const auto& p : splits) {
+	// for every GT label, in increasing label order
+	std::vector<unsigned int> splits = getSortedSplits(side);
 
-		size_t gtLabel = p.first;
+	// the errors of each label are found independently, start with the 
+	// largest labels to keep all threads busy
+	std::vector<unsigned int> order = getProcessingOrder(side, splits);
+	std::vector<std::vector<ErrorType>> labelErrors(splits.size());
 
-		// map from REC label x REC label to split error
-		std::map<size_t, std::map<size_t, ErrorType>> splitErrors;
+	parallelFor(
+			order.size(),
+			_numThreads,
+			[&](size_t j) {
 
-		size_t maxOverlapRecLabel = 0;
-		size_t maxOverlap = 0;
+				unsigned int i = order[j];
+				labelErrors[i] = getLabelSplitErrors<ErrorType>(side, splits[i], partners, partnerIdByMatch);
+			});
 
-		// for all pairs of labels that split gtLabel
-		for (const auto& q : p.second) {
+	// concatenate in label order
+	std::vector<ErrorType> mstSplitErrors;
+	for (const std::vector<ErrorType>& errors : labelErrors)
+		mstSplitErrors.insert(mstSplitErrors.end(), errors.begin(), errors.end());
 
-			size_t recLabel1 = q.first;
-			std::set<unsigned int> splitCells1 = cellsByGtToRecLabel[gtLabel][recLabel1];
+	return mstSplitErrors;
+}
 
-			// find max overlap REC label
-			size_t overlap = 0;
-			for (unsigned int cellIndex : splitCells1)
-				overlap += (*_cells)[cellIndex].size();
-			if (overlap >= maxOverlap) {
+template <typename ErrorType>
+std::vector<ErrorType>
+TolerantEditDistanceErrors::getLabelSplitErrors(
+		const Side& side,
+		unsigned int id,
+		const Side& partners,
+		const std::vector<unsigned int>& partnerIdByMatch) {
 
-				maxOverlap = overlap;
-				maxOverlapRecLabel = recLabel1;
-			}
+	std::vector<ErrorType> mstSplitErrors;
 
-			// comput split errors to all other REC labels splitting the current 
-			// GT label
-			for (const auto& r : p.second) {
+	// the REC labels that split the GT label, in increasing label order, 
+	// such that the MST is grown in the same order as before
+	std::vector<std::pair<size_t, unsigned int>> splitLabels = getPartners(side, id, partners, partnerIdByMatch);
+	unsigned int n = splitLabels.size();
 
-				size_t recLabel2 = r.first;
+	// the closest locations between two labels are on their surfaces
+	std::vector<CellSurface> surfaces;
+	for (unsigned int i = 0; i < n; i++)
+		surfaces.push_back(CellSurface(*_cells, _cellsByMatch[splitLabels[i].second]));
 
-				// assert recLabel1 < recLabel2
-				if (recLabel2 <= recLabel1)
-					continue;
+	// find max overlap REC label
+	unsigned int maxOverlapIndex = 0;
+	size_t maxOverlap = 0;
+	for (unsigned int i = 0; i < n; i++) {
 
-				std::set<unsigned int> splitCells2 = cellsByGtToRecLabel[gtLabel][recLabel2];
+		size_t overlap = getMatchSize(splitLabels[i].second);
+		if (overlap >= maxOverlap) {
 
-				ErrorType splitError = computeError<ErrorType>(splitCells1, splitCells2);
-				splitErrors[recLabel1][recLabel2] = splitError;
-				splitErrors[recLabel2][recLabel1] = splitError;
-			}
+			maxOverlap = overlap;
+			maxOverlapIndex = i;
 		}
+	}
+
+	// Split errors are only needed along the edges of the MST of the 
+	// REC labels. Find the tree without computing the errors between all 
+	// pairs of labels first.
+	SurfaceSpanningTree tree(surfaces);
 
-		auto cmp = [](const ErrorType& a, const ErrorType& b) { return a.distance > b.distance; };
-		std::priority_queue<ErrorType, std::vector<ErrorType>, decltype(cmp)> mstBoundary(cmp);
-		std::set<size_t> inTree;
+	// split errors along the tree edges, and the tree edges of each label
+	std::vector<ErrorType> splitErrors;
+	std::vector<std::vector<unsigned int>> treeEdges(n);
 
-		// start growing from the maxOverlapRecLabel
-		inTree.insert(maxOverlapRecLabel);
-		for (const auto& p : splitErrors[maxOverlapRecLabel])
-			mstBoundary.push(p.second);
+	for (const auto& edge : tree.getEdges()) {
 
-		// grow the MST
-		while (mstBoundary.size() > 0) {
+		unsigned int i = edge.first;
+		unsigned int j = edge.second;
+
+		treeEdges[i].push_back(splitErrors.size());
+		treeEdges[j].push_back(splitErrors.size());
+
+		splitErrors.push_back(
+				computeError<ErrorType>(
+						_cellsByMatch[splitLabels[i].second],
+						_cellsByMatch[splitLabels[j].second],
+						surfaces[i],
+						surfaces[j]));
+	}
 
-			// get the next cheapest edge
-			ErrorType splitError = mstBoundary.top();
-			mstBoundary.pop();
+	// Report the errors in the order in which Prim's algorithm would add 
+	// them to the MST, growing from the max overlap REC label. Edges of 
+	// the boundary are (index into splitErrors, label to add).
+	typedef std::pair<unsigned int, unsigned int> Edge;
+	auto cmp = [&](const Edge& a, const Edge& b) {
+		return splitErrors[a.first].distance > splitErrors[b.first].distance;
+	};
+	std::priority_queue<Edge, std::vector<Edge>, decltype(cmp)> mstBoundary(cmp);
+	std::vector<char> inTree(n, false);
 
-			// get the label to add
-			auto p = splitError.getErrorLabels();
-			size_t newLabel = inTree.count(p.first) ? p.second : p.first;
+	auto addToTree = [&](unsigned int index) {
 
-			// if already part of the tree, continue
-			if (inTree.count(newLabel))
-				continue;
+		inTree[index] = true;
 
-			// get the overlap of this label with the GT label
-			size_t overlap = 0;
-			for (unsigned int cellIndex : cellsByGtToRecLabel[gtLabel][newLabel])
-				overlap += (*_cells)[cellIndex].size();
+		for (unsigned int e : treeEdges[index]) {
 
-			splitError.size = overlap;
-			mstSplitErrors.push_back(splitError);
-			inTree.insert(newLabel);
+			const auto& edge = tree.getEdges()[e];
+			unsigned int other = (edge.first == index ? edge.second : edge.first);
 
-			for (const auto& p : splitErrors[newLabel])
-				if (!inTree.count(p.first))
-					mstBoundary.push(p.second);
+			if (!inTree[other])
+				mstBoundary.push(Edge(e, other));
 		}
+	};
+
+	addToTree(maxOverlapIndex);
+
+	// grow the MST
+	while (mstBoundary.size() > 0) {
+
+		// get the next cheapest edge
+		Edge edge = mstBoundary.top();
+		mstBoundary.pop();
+
+		// get the label to add
+		unsigned int newIndex = edge.second;
+
+		// get the overlap of this label with the GT label
+		ErrorType splitError = splitErrors[edge.first];
+		splitError.size = getMatchSize(splitLabels[newIndex].second);
+		mstSplitErrors.push_back(splitError);
+
+		addToTree(newIndex);
 	}
 
 	return mstSplitErrors;
@@ -371,52 +524,21 @@ TolerantEditDistanceErrors::getGenericSplitErrors(
 template <typename ErrorType>
 ErrorType
 TolerantEditDistanceErrors::computeError(
-		const std::set<unsigned int>& cells1,
-		const std::set<unsigned int>& cells2) {
+		const std::vector<unsigned int>& cells1,
+		const std::vector<unsigned int>& cells2,
+		const CellSurface& surface1,
+		const CellSurface& surface2) {
 
 	if (cells1.size()*cells2.size() == 0)
 		UTIL_THROW_EXCEPTION(SizeMismatchError, "can not find error location for empty set of cells");
 
 	ErrorType error;
+	error.initFromCells((*_cells)[cells1[0]], (*_cells)[cells2[0]]);
 
-	double minDistance = std::numeric_limits<double>::infinity();
 	Cell<size_t>::Location closest1(0,0,0);
 	Cell<size_t>::Location closest2(0,0,0);
 
-	bool initError = true;
-
-	for (unsigned int i : cells1) {
-
-		const Cell<size_t>& cell1 = (*_cells)[i];
-
-		for (unsigned int j : cells2) {
-
-			const Cell<size_t>& cell2 = (*_cells)[j];
-
-			if (initError) {
-
-				error.initFromCells(cell1, cell2);
-				initError = false;
-			}
-
-			for (const Cell<size_t>::Location& l1 : cell1) {
-				for (const Cell<size_t>::Location& l2 : cell2) {
-
-					int dx = (int)(l1.x)-l2.x;
-					int dy = (int)(l1.y)-l2.y;
-					int dz = (int)(l1.z)-l2.z;
-
-					double distance2 = pow(dx,2)+pow(dy,2)+pow(dz,2);
-					if (distance2 <= minDistance) {
-
-						closest1 = l1;
-						closest2 = l2;
-						minDistance = distance2;
-					}
-				}
-			}
-		}
-	}
+	double minDistance = surface1.findClosestPair(surface2, closest1, closest2);
 
 	error.distance = sqrt(minDistance);
 	error.location = Cell<size_t>::Location(
@@ -441,44 +563,123 @@ TolerantEditDistanceErrors::updateErrorCounts() {
 	_numMerges = 0;
 	_numFalsePositives = 0;
 	_numFalseNegatives = 0;
-	_splits.clear();
-	_merges.clear();
 
-	findSplits(_cellsByGtToRecLabel, _splits, _numSplits, _numFalsePositives, _gtBackgroundLabel);
-	findSplits(_cellsByRecToGtLabel, _merges, _numMerges, _numFalseNegatives, _recBackgroundLabel);
+	findSplits(_gt, _numSplits, _numFalsePositives, _gtBackgroundLabel);
+	findSplits(_rec, _numMerges, _numFalseNegatives, _recBackgroundLabel);
 }
 
 void
 TolerantEditDistanceErrors::findSplits(
-		const cell_map_t& cellMap,
-		cell_map_t&       splits,
-		unsigned int&     numSplits,
-		unsigned int&     numFalsePositives,
-		size_t             backgroundLabel) {
+		Side&         side,
+		unsigned int& numSplits,
+		unsigned int& numFalsePositives,
+		size_t        backgroundLabel) {
 
-	typedef cell_map_t::value_type mapping_t;
+	side.splits.clear();
 
-	for (const mapping_t& i : cellMap) {
+	for (unsigned int id = 0; id < side.ids.size(); id++) {
 
-		unsigned int partners = i.second.size();
+		unsigned int partners = side.matches[id].size();
 
 		// one-to-one mapping is okay
 		if (partners == 1)
 			continue;
 
 		// remember the split
-		splits[i.first] = i.second;
+		side.splits.push_back(id);
 
 		// increase count
-		if (_haveBackgroundLabel && i.first == backgroundLabel)
+		if (_haveBackgroundLabel && side.ids.getLabel(id) == backgroundLabel)
 			numFalsePositives += partners - 1;
 		else
 			numSplits += partners - 1;
 	}
 }
 
-void
-TolerantEditDistanceErrors::addEntry(cell_map_t& map, size_t a, size_t b, unsigned int cellIndex) {
+unsigned int
+TolerantEditDistanceErrors::getLabelId(Side& side, size_t label) {
+
+	unsigned int id = side.ids.insert(label);
+
+	if (id == side.matches.size())
+		side.matches.push_back(std::vector<unsigned int>());
+
+	return id;
+}
+
+std::vector<std::pair<size_t, unsigned int>>
+TolerantEditDistanceErrors::getPartners(
+		const Side& side,
+		unsigned int id,
+		const Side& partners,
+		const std::vector<unsigned int>& partnerIdByMatch) {
+
+	std::vector<std::pair<size_t, unsigned int>> labels;
+
+	for (unsigned int match : side.matches[id])
+		labels.push_back(std::make_pair(partners.ids.getLabel(partnerIdByMatch[match]), match));
+	std::sort(labels.begin(), labels.end());
+
+	return labels;
+}
+
+TolerantEditDistanceErrors::cell_map_t
+TolerantEditDistanceErrors::getPartnerCells(
+		const Side& side,
+		size_t label,
+		const Side& partners,
+		const std::vector<unsigned int>& partnerIdByMatch) {
+
+	cell_map_t cells;
+
+	// only labels that are matched to more than one partner
+	unsigned int id = side.ids.find(label);
+	if (id == DenseLabels::NoId || side.matches[id].size() < 2)
+		return cells;
+
+	for (unsigned int match : side.matches[id])
+		cells[partners.ids.getLabel(partnerIdByMatch[match])] = _cellsByMatch[match];
+
+	return cells;
+}
+
+std::vector<unsigned int>
+TolerantEditDistanceErrors::getSortedSplits(const Side& side) {
+
+	std::vector<unsigned int> splits = side.splits;
+
+	std::sort(
+			splits.begin(),
+			splits.end(),
+			[&](unsigned int a, unsigned int b) { return side.ids.getLabel(a) < side.ids.getLabel(b); });
+
+	return splits;
+}
+
+std::vector<unsigned int>
+TolerantEditDistanceErrors::getProcessingOrder(
+		const Side& side,
+		const std::vector<unsigned int>& ids) {
+
+	std::vector<size_t> sizes(ids.size(), 0);
+	for (unsigned int i = 0; i < ids.size(); i++)
+		for (unsigned int match : side.matches[ids[i]])
+			sizes[i] += getMatchSize(match);
+
+	std::vector<unsigned int> order(ids.size());
+	for (unsigned int i = 0; i < order.size(); i++)
+		order[i] = i;
+
+	std::stable_sort(
+			order.begin(),
+			order.end(),
+			[&](unsigned int a, unsigned int b) { return sizes[a] > sizes[b]; });
+
+	return order;
+}
+
+size_t
+TolerantEditDistanceErrors::getMatchSize(unsigned int match) const {
 
-	map[a][b].insert(cellIndex);
+	return _overlapByMatch[match];
 }
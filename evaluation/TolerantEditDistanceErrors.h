@@ -1,7 +1,13 @@
 #ifndef TED_EVALUATION_TOLERANT_EDIT_DISTANCE_ERRORS_H__
 #define TED_EVALUATION_TOLERANT_EDIT_DISTANCE_ERRORS_H__
 
+#include <map>
+#include <set>
+#include <vector>
+
 #include "Cells.h"
+#include "CellSurface.h"
+#include "DenseLabels.h"
 
 /**
  * Representation of split and merge (and optionally false positive and false 
@@ -14,7 +20,10 @@ class TolerantEditDistanceErrors {
 
 public:
 
-	typedef std::map<size_t, std::map<size_t, std::set<unsigned int> > > cell_map_t;
+	/**
+	 * Cell indices by label, as returned by getSplitCells() and friends.
+	 */
+	typedef std::map<size_t, std::vector<unsigned int> > cell_map_t;
 
 	/**
 	 * Represents match between a ground-truth label and a reconstruction label, 
@@ -215,24 +224,26 @@ public:
 	std::set<size_t> getFalseNegatives();
 
 	/**
-	 * Get all cells that split the given ground truth label.
+	 * Get all cells that split the given ground truth label, by reconstruction 
+	 * label.
 	 */
-	const cell_map_t::mapped_type& getSplitCells(size_t gtLabel);
+	cell_map_t getSplitCells(size_t gtLabel);
 
 	/**
-	 * Get all cells that the given reconstruction label merges.
+	 * Get all cells that the given reconstruction label merges, by ground 
+	 * truth label.
 	 */
-	const cell_map_t::mapped_type& getMergeCells(size_t recLabel);
+	cell_map_t getMergeCells(size_t recLabel);
 
 	/**
-	 * Get all cells that are false positives.
+	 * Get all cells that are false positives, by reconstruction label.
 	 */
-	const cell_map_t::mapped_type& getFalsePositiveCells();
+	cell_map_t getFalsePositiveCells();
 
 	/**
-	 * Get all cells that are false negatives.
+	 * Get all cells that are false negatives, by ground truth label.
 	 */
-	const cell_map_t::mapped_type& getFalseNegativeCells();
+	cell_map_t getFalseNegativeCells();
 
 	/**
 	 * Get a vector of all split errors, containing the locations and sizes of 
@@ -254,6 +265,20 @@ public:
 	 */
 	std::vector<MergeError> getMergeErrors();
 
+	/**
+	 * Same as getSplitErrors() and getMergeErrors(), but finds the split and 
+	 * merge errors concurrently.
+	 */
+	void getSplitAndMergeErrors(
+			std::vector<SplitError>& splitErrors,
+			std::vector<MergeError>& mergeErrors);
+
+	/**
+	 * Set the number of threads to find error locations with. 0 for all 
+	 * available hardware threads.
+	 */
+	void setNumThreads(unsigned int numThreads) { _numThreads = numThreads; }
+
 	/**
 	 * Check whether a background label was considered for the TED errors. If 
 	 * yes, some of the split and merge errors have an interpretation as false 
@@ -265,46 +290,157 @@ public:
 
 	double getInferenceTime() const { return _inferenceTime; }
 
+	/**
+	 * Set a lower bound on the number of errors, i.e., the number of errors 
+	 * of the best possible solution.
+	 */
+	void setLowerBound(unsigned int lowerBound) { _lowerBound = lowerBound; }
+
+	/**
+	 * Get the lower bound on the number of errors. Equal to getNumErrors() if 
+	 * the errors are optimal.
+	 */
+	unsigned int getLowerBound() const { return _lowerBound; }
+
+	/**
+	 * Get the relative optimality gap of the number of errors, i.e., 
+	 * (getNumErrors() - getLowerBound())/getNumErrors(). 0 if the errors are 
+	 * optimal.
+	 */
+	double getOptimalityGap() {
+
+		unsigned int numErrors = getNumErrors();
+
+		if (numErrors <= _lowerBound)
+			return 0;
+
+		return static_cast<double>(numErrors - _lowerBound)/numErrors;
+	}
+
 	void setNumVariables(int num) { _numVariables = num; }
 
 	int getNumVariables() const { return _numVariables; }
 
+	void setNumEliminatedVariables(int num) { _numEliminatedVariables = num; }
+
+	int getNumEliminatedVariables() const { return _numEliminatedVariables; }
+
+	void setNumConstraints(int num) { _numConstraints = num; }
+
+	int getNumConstraints() const { return _numConstraints; }
+
+	void setNumNonZeros(size_t num) { _numNonZeros = num; }
+
+	size_t getNumNonZeros() const { return _numNonZeros; }
+
 private:
 
-	void addEntry(cell_map_t& map, size_t a, size_t b, unsigned int v);
+	// one side (ground truth or reconstruction) of the confusion matrix
+	struct Side {
+
+		// dense ids for the labels of this side, in order of appearance
+		DenseLabels ids;
+
+		// the matches of each label id
+		std::vector<std::vector<unsigned int> > matches;
+
+		// the ids of labels that are matched to more than one partner
+		std::vector<unsigned int> splits;
+
+		void clear() { ids.clear(); matches.clear(); splits.clear(); }
+	};
+
+	// pack a pair of ground truth and reconstruction label ids into one key
+	static size_t getMatchKey(unsigned int gtId, unsigned int recId) {
+
+		return (static_cast<size_t>(gtId) << 32) | recId;
+	}
+
+	// get the id of a label on the given side, creating it if necessary
+	unsigned int getLabelId(Side& side, size_t label);
+
+	// get the matches of the given label id, as (partner label, match id) 
+	// pairs in increasing label order
+	std::vector<std::pair<size_t, unsigned int> > getPartners(
+			const Side& side,
+			unsigned int id,
+			const Side& partners,
+			const std::vector<unsigned int>& partnerIdByMatch);
+
+	// get the cells of the matches of the given label, by partner label
+	cell_map_t getPartnerCells(
+			const Side& side,
+			size_t label,
+			const Side& partners,
+			const std::vector<unsigned int>& partnerIdByMatch);
+
+	// get the ids of the split labels of a side, in increasing label order
+	std::vector<unsigned int> getSortedSplits(const Side& side);
+
+	// get the number of locations in the cells of a match
+	size_t getMatchSize(unsigned int match) const;
 
 	void updateErrorCounts();
 
 	void findSplits(
-			const cell_map_t& cellMap,
-			cell_map_t&       splits,
-			unsigned int&     numSplits,
-			unsigned int&     numFalsePositives,
-			size_t             backgroundLabel);
+			Side&         side,
+			unsigned int& numSplits,
+			unsigned int& numFalsePositives,
+			size_t        backgroundLabel);
 
+	// find the closest locations between two sets of cells, given their 
+	// surfaces
 	template <typename ErrorType>
 	ErrorType computeError(
-			const std::set<unsigned int>& cells1,
-			const std::set<unsigned int>& cells2);
+			const std::vector<unsigned int>& cells1,
+			const std::vector<unsigned int>& cells2,
+			const CellSurface& surface1,
+			const CellSurface& surface2);
 
 	// generic function to find split errors, can be used to find merge errors 
-	// as well, if _merges and _cellsByRecToGtLabel are fed with MergeError as 
-	// template argument
+	// as well, if the reconstruction side is fed with MergeError as template 
+	// argument
 	template <typename ErrorType>
 	std::vector<ErrorType> getGenericSplitErrors(
-			cell_map_t& splits,
-			cell_map_t& cellsByGtToRecLabel);
+			const Side& side,
+			const Side& partners,
+			const std::vector<unsigned int>& partnerIdByMatch);
+
+	// find the split errors of one label id of a side
+	template <typename ErrorType>
+	std::vector<ErrorType> getLabelSplitErrors(
+			const Side& side,
+			unsigned int id,
+			const Side& partners,
+			const std::vector<unsigned int>& partnerIdByMatch);
+
+	// get the order in which to find the split errors of the given label ids 
+	// (as indices into ids), largest labels first
+	std::vector<unsigned int> getProcessingOrder(
+			const Side& side,
+			const std::vector<unsigned int>& ids);
 
 	// a list of cells partitioning the image
 	std::shared_ptr<Cells> _cells;
 
-	// sparse representation of groundtruth to reconstruction confusion matrix
-	cell_map_t _cellsByRecToGtLabel;
-	cell_map_t _cellsByGtToRecLabel;
+	// sparse representation of groundtruth to reconstruction confusion 
+	// matrix, over dense label ids
+	Side _gt;
+	Side _rec;
+
+	// the id of each match, by match key
+	DenseLabels _matchIds;
+
+	// the ground truth and reconstruction label id of each match
+	std::vector<unsigned int> _gtIdByMatch;
+	std::vector<unsigned int> _recIdByMatch;
 
-	// subset of the confusion matrix without one-to-one mappings
-	cell_map_t _splits;
-	cell_map_t _merges;
+	// the sorted cell indices of each match
+	std::vector<std::vector<unsigned int> > _cellsByMatch;
+
+	// the number of locations in the cells of each match, accumulated in 
+	// addMapping()
+	std::vector<size_t> _overlapByMatch;
 
 	unsigned int _numSplits;
 	unsigned int _numMerges;
@@ -320,7 +456,17 @@ private:
 
 	double _inferenceTime;
 
+	unsigned int _lowerBound;
+
 	int _numVariables;
+
+	int _numEliminatedVariables;
+
+	int _numConstraints;
+
+	size_t _numNonZeros;
+
+	unsigned int _numThreads;
 };
 
 #endif // TED_EVALUATION_TOLERANT_EDIT_DISTANCE_ERRORS_H__
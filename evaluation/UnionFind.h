@@ -0,0 +1,157 @@
+#ifndef TED_EVALUATION_UNION_FIND_H__
+#define TED_EVALUATION_UNION_FIND_H__
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+/**
+ * Disjoint sets over the elements 0,...,n-1. The representative of each set
+ * is its smallest element, such that representatives do not depend on the
+ * order in which sets are merged.
+ */
+template <typename IndexType = unsigned int>
+class UnionFind {
+
+public:
+
+	UnionFind(IndexType n = 0) {
+
+		_parents.resize(n);
+		for (IndexType i = 0; i < n; i++)
+			_parents[i] = i;
+	}
+
+	/**
+	 * Add a new singleton set and return its element.
+	 */
+	IndexType add() {
+
+		IndexType i = _parents.size();
+		_parents.push_back(i);
+
+		return i;
+	}
+
+	/**
+	 * Get the representative of the set containing element i.
+	 */
+	IndexType find(IndexType i) {
+
+		while (_parents[i] != i) {
+
+			// path halving
+			_parents[i] = _parents[_parents[i]];
+			i = _parents[i];
+		}
+
+		return i;
+	}
+
+	/**
+	 * Merge the sets containing elements a and b. Returns the representative
+	 * of the merged set.
+	 */
+	IndexType merge(IndexType a, IndexType b) {
+
+		a = find(a);
+		b = find(b);
+
+		if (a < b) {
+
+			_parents[b] = a;
+			return a;
+		}
+
+		_parents[a] = b;
+		return b;
+	}
+
+	/**
+	 * The number of elements.
+	 */
+	IndexType size() const { return _parents.size(); }
+
+private:
+
+	std::vector<IndexType> _parents;
+};
+
+/**
+ * Disjoint sets over the elements 0,...,n-1 that can be merged concurrently
+ * from several threads. As for UnionFind, the representative of each set is
+ * its smallest element.
+ */
+template <typename IndexType = unsigned int>
+class ConcurrentUnionFind {
+
+public:
+
+	ConcurrentUnionFind(IndexType n) :
+		_parents(n) {
+
+		for (IndexType i = 0; i < n; i++)
+			_parents[i] = i;
+	}
+
+	/**
+	 * Set the parent of element i. Not thread-safe, use only to initialize 
+	 * the sets before merging. The parent has to be smaller than i.
+	 */
+	void setParent(IndexType i, IndexType parent) { _parents[i] = parent; }
+
+	/**
+	 * Get the representative of the set containing element i. Only guaranteed 
+	 * to be the final representative after all merges are done.
+	 */
+	IndexType find(IndexType i) {
+
+		IndexType parent = _parents[i];
+		while (parent != i) {
+
+			// path halving, it is fine if this fails due to a concurrent update
+			IndexType grandParent = _parents[parent];
+			_parents[i].compare_exchange_weak(parent, grandParent);
+
+			i = grandParent;
+			parent = _parents[i];
+		}
+
+		return i;
+	}
+
+	/**
+	 * Merge the sets containing elements a and b.
+	 */
+	void merge(IndexType a, IndexType b) {
+
+		while (true) {
+
+			a = find(a);
+			b = find(b);
+
+			if (a == b)
+				return;
+
+			if (a > b)
+				std::swap(a, b);
+
+			// link b to a, if b is still a root
+			IndexType expected = b;
+			if (_parents[b].compare_exchange_strong(expected, a))
+				return;
+		}
+	}
+
+	/**
+	 * The number of elements.
+	 */
+	IndexType size() const { return _parents.size(); }
+
+private:
+
+	std::vector<std::atomic<IndexType>> _parents;
+};
+
+#endif // TED_EVALUATION_UNION_FIND_H__
+
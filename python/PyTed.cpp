@@ -1,7 +1,6 @@
 #include <boost/python/numeric.hpp> // TODO: needed?
 #define NPY_NO_DEPRECATED_API NPY_1_7_API_VERSION
 #include <numpy/arrayobject.h>
-#include <util/ProgramOptions.h>
 #include <util/exceptions.h>
 #include <evaluation/VariationOfInformation.h>
 #include <evaluation/RandIndex.h>
@@ -48,13 +47,57 @@ PyTed::setNumThreads(int numThreads) {
 boost::python::dict
 PyTed::createReport(PyObject* gt, PyObject* rec, PyObject* voxel_size, PyObject* corrected) {
 
-	util::ProgramOptions::setOptionValue("numThreads", util::to_string(_numThreads));
-
-	boost::python::dict summary;
-
 	ImageStack groundTruth = imageStackFromArray(gt, voxel_size);
 	ImageStack reconstruction = imageStackFromArray(rec, voxel_size);
 
+	std::unique_ptr<TolerantEditDistance> ted;
+	if (_parameters.reportTed)
+		ted = createTed(groundTruth);
+
+	return createReport(groundTruth, reconstruction, ted.get(), corrected);
+}
+
+std::unique_ptr<TolerantEditDistance>
+PyTed::createTed(const ImageStack& groundTruth) {
+
+	TolerantEditDistance::Parameters tedParameters;
+	tedParameters.fromSkeleton = _parameters.fromSkeleton;
+	tedParameters.distanceThreshold = _parameters.distanceThreshold;
+	tedParameters.reportFPsFNs = _parameters.haveBackground;
+	tedParameters.allowBackgroundAppearance = true; // to be backwards compatible, might change at some point
+	tedParameters.gtBackgroundLabel = _parameters.gtBackgroundLabel;
+	tedParameters.recBackgroundLabel = _parameters.recBackgroundLabel;
+	tedParameters.timeout = _parameters.tedTimeout;
+	tedParameters.anytime = _parameters.tedAnytime;
+	tedParameters.numThreads = _numThreads;
+	if (_parameters.tedDistanceTransformSearch)
+		tedParameters.alternativeLabelSearch = DistanceToleranceFunction::DistanceTransform;
+	if (_parameters.tedBranchAndBound)
+		tedParameters.solverBackend = BranchAndBound;
+	if (_parameters.tedLpRelaxation)
+		tedParameters.approximation = TolerantEditDistanceComponent::LpRelaxation;
+	if (_parameters.tedGreedy)
+		tedParameters.approximation = TolerantEditDistanceComponent::Greedy;
+	if (_parameters.tedCompactIlp)
+		tedParameters.formulation = TolerantEditDistanceComponent::Compact;
+	if (_parameters.reportTedErrorVoxels)
+		tedParameters.errorLocations = TolerantEditDistance::SparseErrorLocations;
+
+	std::unique_ptr<TolerantEditDistance> ted(new TolerantEditDistance(tedParameters));
+	ted->setGroundTruth(groundTruth);
+
+	return ted;
+}
+
+boost::python::dict
+PyTed::createReport(
+		const ImageStack& groundTruth,
+		const ImageStack& reconstruction,
+		TolerantEditDistance* ted,
+		PyObject* corrected) {
+
+	boost::python::dict summary;
+
 	if (_parameters.reportVoi) {
 
 		VariationOfInformation voi(_parameters.ignoreBackground);
@@ -77,17 +120,7 @@ PyTed::createReport(PyObject* gt, PyObject* rec, PyObject* voxel_size, PyObject*
 
 	if (_parameters.reportTed) {
 
-		TolerantEditDistance::Parameters tedParameters;
-		tedParameters.fromSkeleton = _parameters.fromSkeleton;
-		tedParameters.distanceThreshold = _parameters.distanceThreshold;
-		tedParameters.reportFPsFNs = _parameters.haveBackground;
-		tedParameters.allowBackgroundAppearance = true; // to be backwards compatible, might change at some point
-		tedParameters.gtBackgroundLabel = _parameters.gtBackgroundLabel;
-		tedParameters.recBackgroundLabel = _parameters.recBackgroundLabel;
-		tedParameters.timeout = _parameters.tedTimeout;
-
-		TolerantEditDistance ted(tedParameters);
-		TolerantEditDistanceErrors errors = ted.compute(groundTruth, reconstruction);
+		TolerantEditDistanceErrors errors = ted->compute(reconstruction);
 
 		boost::python::dict splits;
 		for (size_t split_label : errors.getSplitLabels()) {
@@ -108,11 +141,11 @@ PyTed::createReport(PyObject* gt, PyObject* rec, PyObject* voxel_size, PyObject*
 		}
 
 		boost::python::list fps;
-		if (tedParameters.reportFPsFNs)
+		if (_parameters.haveBackground)
 			for (size_t l : errors.getFalsePositives())
 				fps.append(l);
 		boost::python::list fns;
-		if (tedParameters.reportFPsFNs)
+		if (_parameters.haveBackground)
 			for (size_t l : errors.getFalseNegatives())
 				fns.append(l);
 
@@ -126,8 +159,12 @@ PyTed::createReport(PyObject* gt, PyObject* rec, PyObject* voxel_size, PyObject*
 
 		if (_parameters.reportTedErrorLocations) {
 
+			std::vector<TolerantEditDistanceErrors::SplitError> tedSplitErrors;
+			std::vector<TolerantEditDistanceErrors::MergeError> tedMergeErrors;
+			errors.getSplitAndMergeErrors(tedSplitErrors, tedMergeErrors);
+
 			boost::python::list splitErrors;
-			for (const TolerantEditDistanceErrors::SplitError& splitError : errors.getSplitErrors()) {
+			for (const TolerantEditDistanceErrors::SplitError& splitError : tedSplitErrors) {
 
 				boost::python::dict split_error;
 				split_error["gt_label"] = splitError.gtLabel;
@@ -144,7 +181,7 @@ PyTed::createReport(PyObject* gt, PyObject* rec, PyObject* voxel_size, PyObject*
 			}
 
 			boost::python::list mergeErrors;
-			for (const TolerantEditDistanceErrors::MergeError& mergeError : errors.getMergeErrors()) {
+			for (const TolerantEditDistanceErrors::MergeError& mergeError : tedMergeErrors) {
 
 				boost::python::dict merge_error;
 				merge_error["rec_label"] = mergeError.recLabel;
@@ -164,22 +201,57 @@ PyTed::createReport(PyObject* gt, PyObject* rec, PyObject* voxel_size, PyObject*
 			summary["merge_errors"] = mergeErrors;
 		}
 
+		if (_parameters.reportTedErrorVoxels) {
+
+			auto errorVoxels = [](const std::vector<TolerantEditDistance::ErrorRuns>& errorRuns) {
+
+				boost::python::list errors;
+				for (const TolerantEditDistance::ErrorRuns& error : errorRuns) {
+
+					boost::python::list runs;
+					for (const Cell<size_t>::Run& run : error.runs)
+						runs.append(boost::python::make_tuple(run.z, run.y, run.xBegin, run.xEnd));
+
+					boost::python::dict error_voxels;
+					error_voxels["gt_label"] = error.gtLabel;
+					error_voxels["rec_label"] = error.recLabel;
+					error_voxels["runs"] = runs;
+
+					errors.append(error_voxels);
+				}
+
+				return errors;
+			};
+
+			summary["split_voxels"] = errorVoxels(ted->getSplitRuns());
+			summary["merge_voxels"] = errorVoxels(ted->getMergeRuns());
+			if (_parameters.haveBackground) {
+				summary["fp_voxels"] = errorVoxels(ted->getFalsePositiveRuns());
+				summary["fn_voxels"] = errorVoxels(ted->getFalseNegativeRuns());
+			}
+		}
+
 		summary["ted_split"] = errors.getNumSplits();
 		summary["ted_merge"] = errors.getNumMerges();
 		summary["splits"] = splits;
 		summary["merges"] = merges;
 		summary["matches"] = matches;
-		if (tedParameters.reportFPsFNs) {
+		if (_parameters.haveBackground) {
 			summary["ted_fp"] = errors.getNumFalsePositives();
 			summary["ted_fn"] = errors.getNumFalseNegatives();
 			summary["fps"] = fps;
 			summary["fns"] = fns;
 		}
+		summary["ted_lower_bound"] = errors.getLowerBound();
+		summary["ted_optimality_gap"] = errors.getOptimalityGap();
 		summary["ted_inference_time"] = errors.getInferenceTime();
 		summary["ted_num_variables"] = errors.getNumVariables();
+		summary["ted_num_eliminated_variables"] = errors.getNumEliminatedVariables();
+		summary["ted_num_constraints"] = errors.getNumConstraints();
+		summary["ted_num_nonzeros"] = errors.getNumNonZeros();
 
 		if (corrected != 0)
-			imageStackToArray(ted.getCorrectedReconstruction(), corrected);
+			imageStackToArray(ted->getCorrectedReconstruction(), corrected);
 	}
 
 	summary["ted_version"] = std::string(__git_sha1);
@@ -1,7 +1,13 @@
+#ifndef TED_PYTHON_PY_TED_H__
+#define TED_PYTHON_PY_TED_H__
+
+#include <memory>
+
 #include <boost/python/dict.hpp>
 
 #include <util/helpers.hpp>
 #include <imageprocessing/ImageStack.h>
+#include <evaluation/TolerantEditDistance.h>
 
 class PyTed {
 
@@ -21,7 +27,14 @@ public:
 			reportDetectionOverlap(false),
 			ignoreBackground(false),
 			tedTimeout(0),
+			tedAnytime(false),
 			reportTedErrorLocations(false),
+			reportTedErrorVoxels(false),
+			tedDistanceTransformSearch(false),
+			tedBranchAndBound(false),
+			tedLpRelaxation(false),
+			tedGreedy(false),
+			tedCompactIlp(false),
 			verbosity(2) {}
 
 		/**
@@ -80,11 +93,57 @@ public:
 		 */
 		double tedTimeout;
 
+		/**
+		 * If set, the TED timeout is a budget for the whole computation, and 
+		 * the best solution found within it is reported together with a lower 
+		 * bound and the optimality gap.
+		 */
+		bool tedAnytime;
+
 		/**
 		 * If set, TED will locate split and merge errors.
 		 */
 		bool reportTedErrorLocations;
 
+		/**
+		 * If set, TED will report the voxels of each split, merge, false 
+		 * positive, and false negative, as runs (z, y, x_begin, x_end) of 
+		 * voxels along x.
+		 */
+		bool reportTedErrorVoxels;
+
+		/**
+		 * If set, TED will find alternative labels for each cell with a 
+		 * distance transform per reconstruction label, instead of scanning the 
+		 * threshold neighborhood of each location.
+		 */
+		bool tedDistanceTransformSearch;
+
+		/**
+		 * If set, TED will use the in-tree branch-and-bound solver instead of 
+		 * an external ILP solver like Gurobi.
+		 */
+		bool tedBranchAndBound;
+
+		/**
+		 * If set, TED will round the solution of the LP relaxation instead of 
+		 * solving the ILP exactly. Faster, but the errors might not be 
+		 * minimal. The LP bound is reported as ted_lower_bound.
+		 */
+		bool tedLpRelaxation;
+
+		/**
+		 * If set, TED will relabel cells greedily instead of solving an ILP. 
+		 * Much faster, but the errors might not be minimal.
+		 */
+		bool tedGreedy;
+
+		/**
+		 * If set, TED will use a compact ILP formulation with fewer 
+		 * constraints.
+		 */
+		bool tedCompactIlp;
+
 		/**
 		 * Level of verbosity.
 		 *
@@ -104,15 +163,30 @@ public:
 	boost::python::dict createReport(PyObject* gt, PyObject* rec, PyObject* voxel_size) { return createReport(gt, rec, voxel_size, 0); }
 	boost::python::dict createReport(PyObject* gt, PyObject* rec, PyObject* voxel_size, PyObject* corrected);
 
-private:
+protected:
+
+	// create a TED with the given ground truth set
+	std::unique_ptr<TolerantEditDistance> createTed(const ImageStack& groundTruth);
+
+	// create the report for the given reconstruction, using the given TED 
+	// (if TED is reported)
+	boost::python::dict createReport(
+			const ImageStack& groundTruth,
+			const ImageStack& reconstruction,
+			TolerantEditDistance* ted,
+			PyObject* corrected);
 
 	ImageStack imageStackFromArray(PyObject* a, PyObject* voxel_size);
 
 	void imageStackToArray(const ImageStack& stack, PyObject* a);
 
-	void initialize();
-
 	Parameters _parameters;
 
 	int _numThreads;
+
+private:
+
+	void initialize();
 };
+
+#endif // TED_PYTHON_PY_TED_H__
@@ -0,0 +1,33 @@
+#include <util/Logger.h>
+#include "PyTedSession.h"
+
+logger::LogChannel pytedsessionlog("pytedsessionlog", "[TedSession] ");
+
+PyTedSession::PyTedSession(PyObject* gt, PyObject* voxel_size, const Parameters& parameters) :
+	PyTed(parameters),
+	_voxelSize(boost::python::handle<>(boost::python::borrowed(voxel_size))) {
+
+	_groundTruth = imageStackFromArray(gt, voxel_size);
+
+	LOG_DEBUG(pytedsessionlog) << "constructed" << std::endl;
+}
+
+void
+PyTedSession::setNumThreads(int numThreads) {
+
+	if (numThreads != _numThreads)
+		_ted.reset();
+
+	PyTed::setNumThreads(numThreads);
+}
+
+boost::python::dict
+PyTedSession::evaluate(PyObject* rec, PyObject* corrected) {
+
+	ImageStack reconstruction = imageStackFromArray(rec, _voxelSize.ptr());
+
+	if (_parameters.reportTed && !_ted)
+		_ted = createTed(_groundTruth);
+
+	return createReport(_groundTruth, reconstruction, _ted.get(), corrected);
+}
@@ -0,0 +1,36 @@
+#ifndef TED_PYTHON_PY_TED_SESSION_H__
+#define TED_PYTHON_PY_TED_SESSION_H__
+
+#include <boost/python/object.hpp>
+
+#include "PyTed.h"
+
+/**
+ * Evaluates several reconstructions against the same ground truth. The ground 
+ * truth is converted and prepared once, and reused by all calls to 
+ * evaluate().
+ */
+class PyTedSession : public PyTed {
+
+public:
+
+	PyTedSession(PyObject* gt, PyObject* voxel_size, const Parameters& parameters = Parameters());
+
+	void setNumThreads(int numThreads);
+
+	boost::python::dict evaluate(PyObject* rec) { return evaluate(rec, 0); }
+	boost::python::dict evaluate(PyObject* rec, PyObject* corrected);
+
+private:
+
+	boost::python::object _voxelSize;
+
+	ImageStack _groundTruth;
+
+	// created on the first evaluation, and whenever the number of threads 
+	// changes
+	std::unique_ptr<TolerantEditDistance> _ted;
+};
+
+#endif // TED_PYTHON_PY_TED_SESSION_H__
+
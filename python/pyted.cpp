@@ -5,6 +5,7 @@
 #include <util/exceptions.h>
 #include <git_sha1.h>
 #include "PyTed.h"
+#include "PyTedSession.h"
 
 template <typename Map, typename K, typename V>
 const V& genericGetter(const Map& map, const K& k) { return map[k]; }
@@ -86,7 +87,14 @@ BOOST_PYTHON_MODULE(pyted) {
 			.def_readwrite("rec_background_label", &PyTed::Parameters::recBackgroundLabel)
 			.def_readwrite("have_background", &PyTed::Parameters::haveBackground)
 			.def_readwrite("ted_timeout", &PyTed::Parameters::tedTimeout)
+			.def_readwrite("ted_anytime", &PyTed::Parameters::tedAnytime)
 			.def_readwrite("report_ted_error_locations", &PyTed::Parameters::reportTedErrorLocations)
+			.def_readwrite("report_ted_error_voxels", &PyTed::Parameters::reportTedErrorVoxels)
+			.def_readwrite("ted_distance_transform_search", &PyTed::Parameters::tedDistanceTransformSearch)
+			.def_readwrite("ted_branch_and_bound", &PyTed::Parameters::tedBranchAndBound)
+			.def_readwrite("ted_lp_relaxation", &PyTed::Parameters::tedLpRelaxation)
+			.def_readwrite("ted_greedy", &PyTed::Parameters::tedGreedy)
+			.def_readwrite("ted_compact_ilp", &PyTed::Parameters::tedCompactIlp)
 			.def_readwrite("verbosity", &PyTed::Parameters::verbosity)
 			;
 
@@ -96,6 +104,13 @@ BOOST_PYTHON_MODULE(pyted) {
 			.def("create_report", (boost::python::dict(PyTed::*)(PyObject*,PyObject*,PyObject*))(&PyTed::createReport))
 			.def("create_report", (boost::python::dict(PyTed::*)(PyObject*,PyObject*,PyObject*,PyObject*))(&PyTed::createReport))
 			;
+
+	boost::python::class_<PyTedSession, boost::noncopyable>("TedSession", boost::python::init<PyObject*, PyObject*>())
+			.def(boost::python::init<PyObject*, PyObject*, PyTed::Parameters>())
+			.def("set_num_threads", &PyTedSession::setNumThreads)
+			.def("evaluate", (boost::python::dict(PyTedSession::*)(PyObject*))(&PyTedSession::evaluate))
+			.def("evaluate", (boost::python::dict(PyTedSession::*)(PyObject*,PyObject*))(&PyTedSession::evaluate))
+			;
 }
 
 } // namespace pyted
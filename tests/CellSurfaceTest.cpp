@@ -0,0 +1,256 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <evaluation/Cells.h>
+#include <evaluation/CellSurface.h>
+#include <evaluation/SurfaceSpanningTree.h>
+#include "tests.h"
+
+namespace {
+
+long long
+distance2(const Cell<size_t>::Location& a, const Cell<size_t>::Location& b) {
+
+	long long dx = static_cast<long long>(a.x) - b.x;
+	long long dy = static_cast<long long>(a.y) - b.y;
+	long long dz = static_cast<long long>(a.z) - b.z;
+
+	return dx*dx + dy*dy + dz*dz;
+}
+
+bool
+equal(const Cell<size_t>::Location& a, const Cell<size_t>::Location& b) {
+
+	return a.x == b.x && a.y == b.y && a.z == b.z;
+}
+
+// random sets of cells in a small volume, each set consists of up to two 
+// interleaved cells
+void
+createRandomCellSets(
+		std::mt19937& random,
+		std::vector<std::vector<Cell<size_t>::Run>>& cellRuns,
+		std::vector<std::vector<unsigned int>>& sets) {
+
+	const int width  = 6;
+	const int height = 5;
+	const int depth  = 3;
+
+	unsigned int numSets = 2 + random()%5;
+
+	// a random label volume, label k > 0 belongs to set k - 1
+	std::vector<unsigned int> labels(width*height*depth);
+	for (unsigned int& label : labels)
+		label = random()%(numSets + 1);
+
+	// each set consists of two interleaved cells
+	std::vector<std::vector<unsigned int>> setCells(numSets);
+	cellRuns.clear();
+	for (unsigned int k = 0; k < numSets; k++)
+		for (unsigned int c = 0; c < 2; c++) {
+
+			setCells[k].push_back(cellRuns.size());
+			cellRuns.push_back(std::vector<Cell<size_t>::Run>());
+		}
+
+	for (int z = 0; z < depth; z++)
+		for (int y = 0; y < height; y++)
+			for (int x = 0; x < width; x++) {
+
+				unsigned int label = labels[(z*height + y)*width + x];
+				if (label == 0)
+					continue;
+
+				std::vector<Cell<size_t>::Run>& runs = cellRuns[setCells[label - 1][(x + y)%2]];
+				if (!runs.empty() && runs.back().z == z && runs.back().y == y && runs.back().xEnd == x)
+					runs.back().xEnd++;
+				else
+					runs.push_back(Cell<size_t>::Run(z, y, x, x + 1));
+			}
+
+	// only non-empty cells and sets
+	sets.clear();
+	for (const std::vector<unsigned int>& cells : setCells) {
+
+		std::vector<unsigned int> set;
+		for (unsigned int cellIndex : cells)
+			if (!cellRuns[cellIndex].empty())
+				set.push_back(cellIndex);
+
+		if (!set.empty())
+			sets.push_back(set);
+	}
+}
+
+void
+fillCells(const std::vector<std::vector<Cell<size_t>::Run>>& cellRuns, Cells& cells) {
+
+	for (unsigned int i = 0; i < cellRuns.size(); i++)
+		for (const Cell<size_t>::Run& run : cellRuns[i])
+			cells[i].add(run);
+}
+
+// the closest pair of locations between two sets of cells, by comparing all 
+// pairs
+long long
+findClosestPairBruteForce(
+		const Cells& cells,
+		const std::vector<unsigned int>& set1,
+		const std::vector<unsigned int>& set2,
+		Cell<size_t>::Location& closest1,
+		Cell<size_t>::Location& closest2) {
+
+	long long best2 = std::numeric_limits<long long>::max();
+
+	// the last closest pair in the order of the cells and their locations
+	for (unsigned int i : set1)
+		for (unsigned int j : set2)
+			for (const Cell<size_t>::Location& a : cells[i])
+				for (const Cell<size_t>::Location& b : cells[j]) {
+
+					long long d2 = distance2(a, b);
+					if (d2 <= best2) {
+
+						best2 = d2;
+						closest1 = a;
+						closest2 = b;
+					}
+				}
+
+	return best2;
+}
+
+// the weight of the minimum spanning tree of a complete graph, given the 
+// squared distances between its nodes, with Prim's algorithm
+double
+findSpanningTreeWeight(const std::vector<std::vector<long long>>& distances2) {
+
+	unsigned int n = distances2.size();
+
+	std::vector<char> inTree(n, false);
+	std::vector<long long> closest2(n, std::numeric_limits<long long>::max());
+	closest2[0] = 0;
+
+	double weight = 0;
+
+	for (unsigned int k = 0; k < n; k++) {
+
+		unsigned int next = n;
+		for (unsigned int i = 0; i < n; i++)
+			if (!inTree[i] && (next == n || closest2[i] < closest2[next]))
+				next = i;
+
+		inTree[next] = true;
+		weight += std::sqrt(static_cast<double>(closest2[next]));
+
+		for (unsigned int i = 0; i < n; i++)
+			if (!inTree[i])
+				closest2[i] = std::min(closest2[i], distances2[next][i]);
+	}
+
+	return weight;
+}
+
+} // anonymous namespace
+
+unsigned int
+testCellSurface() {
+
+	std::mt19937 random(42);
+	unsigned int numFailed = 0;
+
+	for (unsigned int round = 0; round < 400; round++) {
+
+		std::vector<std::vector<Cell<size_t>::Run>> cellRuns;
+		std::vector<std::vector<unsigned int>> sets;
+		createRandomCellSets(random, cellRuns, sets);
+
+		std::vector<size_t> numRuns;
+		for (const std::vector<Cell<size_t>::Run>& runs : cellRuns)
+			numRuns.push_back(runs.size());
+
+		Cells cells(numRuns);
+		fillCells(cellRuns, cells);
+
+		std::vector<CellSurface> surfaces;
+		for (const std::vector<unsigned int>& set : sets)
+			surfaces.push_back(CellSurface(cells, set));
+
+		for (unsigned int a = 0; a < sets.size(); a++)
+			for (unsigned int b = a + 1; b < sets.size(); b++) {
+
+				Cell<size_t>::Location expected1(0, 0, 0);
+				Cell<size_t>::Location expected2(0, 0, 0);
+				long long expected = findClosestPairBruteForce(cells, sets[a], sets[b], expected1, expected2);
+
+				Cell<size_t>::Location closest1(0, 0, 0);
+				Cell<size_t>::Location closest2(0, 0, 0);
+				long long found = surfaces[a].findClosestPair(surfaces[b], closest1, closest2);
+
+				std::string where = "round " + std::to_string(round);
+
+				numFailed += !TED_CHECK(found == expected, where);
+				numFailed += !TED_CHECK(equal(closest1, expected1) && equal(closest2, expected2), where);
+			}
+	}
+
+	return numFailed;
+}
+
+unsigned int
+testSurfaceSpanningTree() {
+
+	std::mt19937 random(42);
+	unsigned int numFailed = 0;
+
+	for (unsigned int round = 0; round < 400; round++) {
+
+		std::vector<std::vector<Cell<size_t>::Run>> cellRuns;
+		std::vector<std::vector<unsigned int>> sets;
+		createRandomCellSets(random, cellRuns, sets);
+
+		std::vector<size_t> numRuns;
+		for (const std::vector<Cell<size_t>::Run>& runs : cellRuns)
+			numRuns.push_back(runs.size());
+
+		Cells cells(numRuns);
+		fillCells(cellRuns, cells);
+
+		unsigned int n = sets.size();
+
+		std::vector<CellSurface> surfaces;
+		for (const std::vector<unsigned int>& set : sets)
+			surfaces.push_back(CellSurface(cells, set));
+
+		std::vector<std::vector<long long>> distances2(n, std::vector<long long>(n, 0));
+		for (unsigned int a = 0; a < n; a++)
+			for (unsigned int b = a + 1; b < n; b++) {
+
+				Cell<size_t>::Location closest1(0, 0, 0);
+				Cell<size_t>::Location closest2(0, 0, 0);
+				distances2[a][b] = distances2[b][a] = findClosestPairBruteForce(cells, sets[a], sets[b], closest1, closest2);
+			}
+
+		SurfaceSpanningTree tree(surfaces);
+
+		double weight = 0;
+		bool ordered = true;
+		for (const auto& edge : tree.getEdges()) {
+
+			weight += std::sqrt(static_cast<double>(distances2[edge.first][edge.second]));
+			ordered &= (edge.first < edge.second);
+		}
+
+		std::string where = "round " + std::to_string(round);
+
+		numFailed += !TED_CHECK(tree.getEdges().size() + 1 == n, where);
+		numFailed += !TED_CHECK(ordered, where);
+		numFailed += !TED_CHECK(std::abs(weight - findSpanningTreeWeight(distances2)) < 1e-9, where);
+	}
+
+	return numFailed;
+}
@@ -0,0 +1,233 @@
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <imageprocessing/ImageStack.h>
+#include <evaluation/LocalToleranceFunction.h>
+#include "tests.h"
+
+namespace {
+
+// a local tolerance function that only extracts cells, optionally with 
+// random non-candidate locations to get lazy cells
+class CellExtractor : public LocalToleranceFunction {
+
+public:
+
+	CellExtractor(unsigned int nonCandidateSeed = 0) :
+		_nonCandidateSeed(nonCandidateSeed) {}
+
+protected:
+
+	void findPossibleCellLabels(
+			std::shared_ptr<Cells> /*cells*/,
+			const ImageStack& /*gtLabels*/,
+			const ImageStack& /*recLabels*/) override {}
+
+	void findNonCandidateLocations(
+			const ImageStack& gtLabels,
+			const ImageStack& /*recLabels*/) override {
+
+		if (_nonCandidateSeed == 0)
+			return;
+
+		std::mt19937 random(_nonCandidateSeed);
+
+		_nonCandidateLocations.reshape(vigra::Shape3(gtLabels.width(), gtLabels.height(), gtLabels.size()));
+		for (unsigned int z = 0; z < gtLabels.size(); z++)
+			for (unsigned int y = 0; y < gtLabels.height(); y++)
+				for (unsigned int x = 0; x < gtLabels.width(); x++)
+					_nonCandidateLocations(x, y, z) = (random()%8 == 0);
+	}
+
+private:
+
+	unsigned int _nonCandidateSeed;
+};
+
+ImageStack
+createRandomStack(
+		std::mt19937& random,
+		unsigned int width,
+		unsigned int height,
+		unsigned int depth,
+		unsigned int numLabels,
+		float largeLabel) {
+
+	ImageStack stack;
+
+	for (unsigned int z = 0; z < depth; z++) {
+
+		std::shared_ptr<Image> section = std::make_shared<Image>(width, height, 0);
+
+		for (unsigned int y = 0; y < height; y++)
+			for (unsigned int x = 0; x < width; x++) {
+
+				unsigned int label = random()%numLabels;
+				(*section)(x, y) = (label == numLabels - 1 && largeLabel > 0 ? largeLabel : label);
+			}
+
+		stack.add(section);
+	}
+
+	return stack;
+}
+
+std::shared_ptr<Cells>
+extractCells(
+		const ImageStack& gt,
+		const ImageStack& rec,
+		LocalToleranceFunction::CellExtraction cellExtraction,
+		unsigned int numThreads,
+		unsigned int nonCandidateSeed) {
+
+	CellExtractor extractor(nonCandidateSeed);
+	extractor.setCellExtraction(cellExtraction);
+	extractor.setNumThreads(numThreads);
+
+	return extractor.extractCells(gt, rec);
+}
+
+// the number of slabs of the blockwise extraction with the given number of 
+// threads that the given cell has locations in
+unsigned int
+countSlabs(const Cell<size_t>& cell, unsigned int depth, unsigned int numSlabs) {
+
+	std::vector<char> inSlab(numSlabs, false);
+	for (const Cell<size_t>::Run& run : cell.getRuns())
+		for (unsigned int s = 0; s < numSlabs; s++)
+			if ((size_t)run.z >= (s*depth)/numSlabs && (size_t)run.z < ((s + 1)*depth)/numSlabs)
+				inSlab[s] = true;
+
+	unsigned int count = 0;
+	for (char c : inSlab)
+		count += c;
+
+	return count;
+}
+
+bool
+equal(const Cell<size_t>& a, const Cell<size_t>& b) {
+
+	if (
+			a.getGroundTruthLabel()    != b.getGroundTruthLabel() ||
+			a.getReconstructionLabel() != b.getReconstructionLabel() ||
+			a.size()                   != b.size())
+		return false;
+
+	Cell<size_t>::Runs runsA = a.getRuns();
+	Cell<size_t>::Runs runsB = b.getRuns();
+
+	if (runsA.size() != runsB.size())
+		return false;
+
+	for (unsigned int i = 0; i < runsA.size(); i++) {
+
+		const Cell<size_t>::Run& runA = runsA.begin()[i];
+		const Cell<size_t>::Run& runB = runsB.begin()[i];
+
+		if (runA.z != runB.z || runA.y != runB.y || runA.xBegin != runB.xBegin || runA.xEnd != runB.xEnd)
+			return false;
+	}
+
+	return true;
+}
+
+// runs are in scan order, and consecutive runs of a row do not touch
+bool
+inScanOrder(const Cell<size_t>& cell) {
+
+	const Cell<size_t>::Run* previous = 0;
+	for (const Cell<size_t>::Run& run : cell.getRuns()) {
+
+		if (previous) {
+
+			if (previous->z > run.z)
+				return false;
+			if (previous->z == run.z && previous->y > run.y)
+				return false;
+			if (previous->z == run.z && previous->y == run.y && previous->xEnd >= run.xBegin)
+				return false;
+		}
+
+		previous = &run;
+	}
+
+	return true;
+}
+
+} // anonymous namespace
+
+unsigned int
+testCellExtraction() {
+
+	const float LargeLabel = 8589934592.0f; // 2^33
+
+	std::mt19937 random(42);
+	unsigned int numFailed = 0;
+
+	// how often a cell spans at least three slabs
+	unsigned int numMultiSlabCells = 0;
+
+	for (unsigned int round = 0; round < 200; round++) {
+
+		unsigned int width  = 1 + random()%8;
+		unsigned int height = 1 + random()%8;
+		unsigned int depth  = 1 + random()%10;
+
+		// few labels give cells that cross slab faces, some rounds need the 
+		// fallback for labels that exceed 32 bit
+		float gtLarge  = (round%10 == 0 ? LargeLabel : 0);
+		float recLarge = (round%10 == 5 ? LargeLabel : 0);
+
+		ImageStack gt  = createRandomStack(random, width, height, depth, 1 + random()%3, gtLarge);
+		ImageStack rec = createRandomStack(random, width, height, depth, 1 + random()%4, recLarge);
+
+		std::shared_ptr<Cells> expected = extractCells(gt, rec, LocalToleranceFunction::VigraLabeling, 1, 0);
+
+		for (unsigned int i = 0; i < expected->size(); i++)
+			numFailed += !TED_CHECK(inScanOrder((*expected)[i]), "vigra labeling in round " + std::to_string(round));
+
+		for (unsigned int nonCandidateSeed : { 0u, round + 1 })
+			for (unsigned int numThreads = 1; numThreads <= depth + 2; numThreads++)
+				for (LocalToleranceFunction::CellExtraction cellExtraction : {
+						LocalToleranceFunction::FusedUnionFind,
+						LocalToleranceFunction::BlockwiseUnionFind }) {
+
+					// the fused extraction does not depend on the number of 
+					// threads
+					if (cellExtraction == LocalToleranceFunction::FusedUnionFind && numThreads > 1)
+						continue;
+
+					std::string where =
+							std::string(cellExtraction == LocalToleranceFunction::FusedUnionFind ? "fused" : "blockwise") +
+							" with " + std::to_string(numThreads) + " threads" +
+							(nonCandidateSeed ? " and lazy cells" : "") +
+							" in round " + std::to_string(round);
+
+					std::shared_ptr<Cells> cells = extractCells(gt, rec, cellExtraction, numThreads, nonCandidateSeed);
+
+					if (!TED_CHECK(cells->size() == expected->size(), where)) {
+
+						numFailed++;
+						continue;
+					}
+
+					for (unsigned int i = 0; i < cells->size(); i++) {
+
+						numFailed += !TED_CHECK(equal((*cells)[i], (*expected)[i]), where + ", cell " + std::to_string(i));
+						numFailed += !TED_CHECK(inScanOrder((*cells)[i]), where + ", cell " + std::to_string(i));
+
+						if (cellExtraction == LocalToleranceFunction::BlockwiseUnionFind && !gtLarge && !recLarge)
+							if (countSlabs((*cells)[i], depth, std::min(numThreads, depth)) >= 3)
+								numMultiSlabCells++;
+					}
+				}
+	}
+
+	numFailed += !TED_CHECK(numMultiSlabCells > 0, "no cell spans three slabs");
+
+	return numFailed;
+}
@@ -0,0 +1,201 @@
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <evaluation/Cells.h>
+#include <evaluation/TolerantEditDistanceComponent.h>
+#include "tests.h"
+
+namespace {
+
+// a random component, with the ground truth label, original reconstruction 
+// label, size, and possible labels of each cell
+struct Instance {
+
+	std::vector<size_t> gtLabels;
+	std::vector<size_t> recLabels;
+	std::vector<size_t> sizes;
+	std::vector<std::vector<size_t>> possibleLabels;
+};
+
+Instance
+createInstance(std::mt19937& random) {
+
+	Instance instance;
+
+	unsigned int numCells = 2 + random()%7;
+
+	for (unsigned int i = 0; i < numCells; i++) {
+
+		instance.gtLabels.push_back(1 + random()%3);
+		instance.recLabels.push_back(1 + random()%4);
+		instance.sizes.push_back(1 + random()%5);
+	}
+
+	std::set<size_t> originalLabels(instance.recLabels.begin(), instance.recLabels.end());
+
+	for (unsigned int i = 0; i < numCells; i++) {
+
+		std::set<size_t> labels;
+		labels.insert(instance.recLabels[i]);
+		for (size_t label : originalLabels)
+			if (random()%3 == 0)
+				labels.insert(label);
+
+		// a label that is no original label of a cell, like background that 
+		// is allowed to appear
+		if (random()%4 == 0)
+			labels.insert(0);
+
+		instance.possibleLabels.push_back(std::vector<size_t>(labels.begin(), labels.end()));
+	}
+
+	return instance;
+}
+
+// the number of splits and merges of a labeling, counted the same way as in 
+// TolerantEditDistanceErrors
+unsigned int
+countErrors(const Instance& instance, const std::vector<size_t>& labeling) {
+
+	std::map<size_t, std::set<size_t>> matchesByGt;
+	std::map<size_t, std::set<size_t>> matchesByRec;
+
+	for (unsigned int i = 0; i < labeling.size(); i++) {
+
+		matchesByGt[instance.gtLabels[i]].insert(labeling[i]);
+		matchesByRec[labeling[i]].insert(instance.gtLabels[i]);
+	}
+
+	unsigned int numErrors = 0;
+	for (const auto& p : matchesByGt)
+		numErrors += p.second.size() - 1;
+	for (const auto& p : matchesByRec)
+		numErrors += p.second.size() - 1;
+
+	return numErrors;
+}
+
+// the smallest number of errors over all labelings
+unsigned int
+findMinimalErrors(const Instance& instance) {
+
+	unsigned int numCells = instance.gtLabels.size();
+
+	std::vector<unsigned int> choices(numCells, 0);
+	std::vector<size_t> labeling(numCells);
+
+	unsigned int minimalErrors = std::numeric_limits<unsigned int>::max();
+
+	while (true) {
+
+		for (unsigned int i = 0; i < numCells; i++)
+			labeling[i] = instance.possibleLabels[i][choices[i]];
+
+		minimalErrors = std::min(minimalErrors, countErrors(instance, labeling));
+
+		// next combination of choices
+		unsigned int i = 0;
+		while (i < numCells && ++choices[i] == instance.possibleLabels[i].size()) {
+
+			choices[i] = 0;
+			i++;
+		}
+
+		if (i == numCells)
+			break;
+	}
+
+	return minimalErrors;
+}
+
+} // anonymous namespace
+
+unsigned int
+testTolerantEditDistanceComponent() {
+
+	struct Configuration {
+
+		std::string name;
+		TolerantEditDistanceComponent::Parameters parameters;
+		bool exact;
+	};
+
+	std::vector<Configuration> configurations(3);
+
+	configurations[0].name = "branch and bound";
+	configurations[0].parameters.solverBackend = BranchAndBound;
+	configurations[0].exact = true;
+
+	configurations[1].name = "branch and bound, compact";
+	configurations[1].parameters.solverBackend = BranchAndBound;
+	configurations[1].parameters.formulation = TolerantEditDistanceComponent::Compact;
+	configurations[1].exact = true;
+
+	configurations[2].name = "greedy";
+	configurations[2].parameters.approximation = TolerantEditDistanceComponent::Greedy;
+	configurations[2].exact = false;
+
+	std::mt19937 random(42);
+	unsigned int numFailed = 0;
+
+	for (unsigned int round = 0; round < 1000; round++) {
+
+		Instance instance = createInstance(random);
+		unsigned int numCells = instance.gtLabels.size();
+
+		Cells cells(std::vector<size_t>(numCells, 1));
+		std::vector<unsigned int> cellIndices;
+
+		for (unsigned int i = 0; i < numCells; i++) {
+
+			cells[i].add(Cell<size_t>::Run(0, i, 0, instance.sizes[i]));
+			cells[i].setGroundTruthLabel(instance.gtLabels[i]);
+			cells[i].setReconstructionLabel(instance.recLabels[i]);
+			for (size_t label : instance.possibleLabels[i])
+				cells[i].addPossibleLabel(label);
+
+			cellIndices.push_back(i);
+		}
+
+		unsigned int minimalErrors = findMinimalErrors(instance);
+
+		for (const Configuration& configuration : configurations) {
+
+			TolerantEditDistanceComponent component(cells, cellIndices);
+			component.solve(configuration.parameters);
+
+			std::string where = configuration.name + " in round " + std::to_string(round);
+
+			std::vector<size_t> labeling(numCells);
+			bool feasible = true;
+			for (unsigned int i = 0; i < numCells; i++) {
+
+				labeling[i] = component.getCellLabel(i);
+				const std::vector<size_t>& possible = instance.possibleLabels[i];
+				feasible &= (std::find(possible.begin(), possible.end(), labeling[i]) != possible.end());
+			}
+
+			unsigned int numErrors = countErrors(instance, labeling);
+			unsigned int numReported = component.getNumSplits() + component.getNumMerges();
+
+			numFailed += !TED_CHECK(feasible, where);
+			numFailed += !TED_CHECK(numReported == numErrors, where);
+			numFailed += !TED_CHECK(component.getLowerBound() <= minimalErrors, where);
+
+			if (configuration.exact) {
+
+				numFailed += !TED_CHECK(component.isOptimal() && numErrors == minimalErrors, where);
+				numFailed += !TED_CHECK(component.getLowerBound() == numReported, where);
+			}
+			else if (component.isOptimal())
+				numFailed += !TED_CHECK(numErrors == minimalErrors, where);
+		}
+	}
+
+	return numFailed;
+}
@@ -0,0 +1,347 @@
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <imageprocessing/ImageStack.h>
+#include <evaluation/TolerantEditDistance.h>
+#include "tests.h"
+
+namespace {
+
+const unsigned int Width  = 14;
+const unsigned int Height = 12;
+const unsigned int Depth  = 5;
+
+struct Seed {
+
+	int x, y, z;
+	float label;
+};
+
+// a label volume that assigns each location the label of the closest seed
+ImageStack
+createVoronoiStack(const std::vector<Seed>& seeds) {
+
+	ImageStack stack;
+
+	for (unsigned int z = 0; z < Depth; z++) {
+
+		std::shared_ptr<Image> section = std::make_shared<Image>(Width, Height, 0);
+
+		for (unsigned int y = 0; y < Height; y++)
+			for (unsigned int x = 0; x < Width; x++) {
+
+				int best = -1;
+				for (const Seed& seed : seeds) {
+
+					int dx = seed.x - (int)x;
+					int dy = seed.y - (int)y;
+					int dz = 2*(seed.z - (int)z);
+					int d  = dx*dx + dy*dy + dz*dz;
+
+					if (best < 0 || d < best) {
+
+						best = d;
+						(*section)(x, y) = seed.label;
+					}
+				}
+			}
+
+		stack.add(section);
+	}
+
+	return stack;
+}
+
+std::vector<Seed>
+createRandomSeeds(std::mt19937& random, unsigned int numSeeds, float firstLabel) {
+
+	std::vector<Seed> seeds;
+	for (unsigned int i = 0; i < numSeeds; i++) {
+
+		Seed seed;
+		seed.x = random()%Width;
+		seed.y = random()%Height;
+		seed.z = random()%Depth;
+
+		// some background seeds
+		seed.label = (random()%5 == 0 ? 0 : firstLabel + i);
+
+		seeds.push_back(seed);
+	}
+
+	return seeds;
+}
+
+// a reconstruction close to the ground truth, with boundaries shifted by up 
+// to two locations and some merges and splits
+ImageStack
+createReconstruction(std::mt19937& random, const std::vector<Seed>& gtSeeds) {
+
+	std::vector<Seed> seeds;
+	for (const Seed& gtSeed : gtSeeds) {
+
+		Seed seed = gtSeed;
+		seed.x += (int)(random()%5) - 2;
+		seed.y += (int)(random()%5) - 2;
+		seed.label = (seed.label == 0 ? 0 : seed.label + 100);
+
+		// merge with the previous seed
+		if (!seeds.empty() && random()%4 == 0)
+			seed.label = seeds.back().label;
+
+		seeds.push_back(seed);
+	}
+
+	// splits
+	std::vector<Seed> extra = createRandomSeeds(random, 2, 200);
+	seeds.insert(seeds.end(), extra.begin(), extra.end());
+
+	return createVoronoiStack(seeds);
+}
+
+// replace the given section by a copy that can be modified
+Image&
+modifySection(ImageStack& stack, unsigned int z) {
+
+	ImageStack copy;
+	for (unsigned int i = 0; i < stack.size(); i++)
+		copy.add(i == z ? std::make_shared<Image>(*stack[i]) : stack[i]);
+
+	stack = copy;
+
+	return *stack[z];
+}
+
+// merge one label into another, returns the merged labels
+std::vector<size_t>
+mergeLabels(std::mt19937& random, ImageStack& rec, vigra::Shape3& changedBegin, vigra::Shape3& changedEnd) {
+
+	float a = (*rec[random()%Depth])(random()%Width, random()%Height);
+	float b = (*rec[random()%Depth])(random()%Width, random()%Height);
+
+	changedBegin = vigra::Shape3(Width, Height, Depth);
+	changedEnd   = vigra::Shape3(0, 0, 0);
+
+	for (unsigned int z = 0; z < Depth; z++)
+		for (unsigned int y = 0; y < Height; y++)
+			for (unsigned int x = 0; x < Width; x++)
+				if ((*rec[z])(x, y) == a && a != b) {
+
+					modifySection(rec, z)(x, y) = b;
+
+					changedBegin[0] = std::min(changedBegin[0], (std::ptrdiff_t)x);
+					changedBegin[1] = std::min(changedBegin[1], (std::ptrdiff_t)y);
+					changedBegin[2] = std::min(changedBegin[2], (std::ptrdiff_t)z);
+					changedEnd[0]   = std::max(changedEnd[0], (std::ptrdiff_t)x + 1);
+					changedEnd[1]   = std::max(changedEnd[1], (std::ptrdiff_t)y + 1);
+					changedEnd[2]   = std::max(changedEnd[2], (std::ptrdiff_t)z + 1);
+				}
+
+	return std::vector<size_t>{ (size_t)a, (size_t)b };
+}
+
+// give the locations of a label inside a random box a new label, returns the 
+// split labels
+std::vector<size_t>
+splitLabel(std::mt19937& random, ImageStack& rec, float newLabel, vigra::Shape3& changedBegin, vigra::Shape3& changedEnd) {
+
+	unsigned int z = random()%Depth;
+	unsigned int y = random()%Height;
+	unsigned int x = random()%Width;
+
+	float a = (*rec[z])(x, y);
+
+	changedBegin = vigra::Shape3(
+			std::max(0, (int)x - (int)(random()%4)),
+			std::max(0, (int)y - (int)(random()%4)),
+			std::max(0, (int)z - (int)(random()%2)));
+	changedEnd = vigra::Shape3(
+			std::min(Width,  x + 1 + (unsigned int)(random()%4)),
+			std::min(Height, y + 1 + (unsigned int)(random()%4)),
+			std::min(Depth,  z + 1 + (unsigned int)(random()%2)));
+
+	for (int bz = changedBegin[2]; bz < changedEnd[2]; bz++)
+		for (int by = changedBegin[1]; by < changedEnd[1]; by++)
+			for (int bx = changedBegin[0]; bx < changedEnd[0]; bx++)
+				if ((*rec[bz])(bx, by) == a)
+					modifySection(rec, bz)(bx, by) = newLabel;
+
+	return std::vector<size_t>{ (size_t)a, (size_t)newLabel };
+}
+
+bool
+equal(const ImageStack& a, const ImageStack& b) {
+
+	if (a.size() != b.size())
+		return false;
+
+	for (unsigned int z = 0; z < a.size(); z++)
+		if (!std::equal(a[z]->begin(), a[z]->end(), b[z]->begin()))
+			return false;
+
+	return true;
+}
+
+unsigned int
+compareErrors(
+		TolerantEditDistanceErrors& errors,
+		TolerantEditDistanceErrors& expected,
+		const std::string& where) {
+
+	unsigned int numFailed = 0;
+
+	numFailed += !TED_CHECK(errors.getNumSplits()         == expected.getNumSplits(),         where);
+	numFailed += !TED_CHECK(errors.getNumMerges()         == expected.getNumMerges(),         where);
+	numFailed += !TED_CHECK(errors.getNumFalsePositives() == expected.getNumFalsePositives(), where);
+	numFailed += !TED_CHECK(errors.getNumFalseNegatives() == expected.getNumFalseNegatives(), where);
+	numFailed += !TED_CHECK(errors.getLowerBound()        == expected.getLowerBound(),        where);
+
+	return numFailed;
+}
+
+TolerantEditDistance::Parameters
+createRandomParameters(std::mt19937& random) {
+
+	TolerantEditDistance::Parameters parameters;
+	parameters.fromSkeleton              = (random()%4 == 0);
+	parameters.distanceThreshold         = 1 + random()%2;
+	parameters.reportFPsFNs              = (random()%2 == 0);
+	parameters.allowBackgroundAppearance = (random()%2 == 0);
+	parameters.solverBackend             = BranchAndBound;
+
+	// exact solutions of the larger components with the higher threshold or 
+	// appearing background take too long for a test
+	if (parameters.distanceThreshold > 1 || parameters.allowBackgroundAppearance)
+		parameters.approximation = TolerantEditDistanceComponent::Greedy;
+	parameters.alternativeLabelSearch    =
+			(random()%2 == 0 ?
+			 DistanceToleranceFunction::NeighborhoodScan :
+			 DistanceToleranceFunction::DistanceTransform);
+
+	return parameters;
+}
+
+} // anonymous namespace
+
+unsigned int
+testTolerantEditDistanceUpdate() {
+
+	std::mt19937 random(42);
+	unsigned int numFailed = 0;
+
+	for (unsigned int round = 0; round < 100; round++) {
+
+		TolerantEditDistance::Parameters parameters = createRandomParameters(random);
+
+		std::vector<Seed> gtSeeds = createRandomSeeds(random, 8, 1);
+		ImageStack gt  = createVoronoiStack(gtSeeds);
+		ImageStack rec = createReconstruction(random, gtSeeds);
+
+		TolerantEditDistance ted(parameters);
+		ted.setGroundTruth(gt);
+		ted.compute(rec);
+
+		for (unsigned int edit = 0; edit < 8; edit++) {
+
+			vigra::Shape3 changedBegin, changedEnd;
+			std::vector<size_t> changedLabels;
+
+			if (random()%2 == 0)
+				changedLabels = mergeLabels(random, rec, changedBegin, changedEnd);
+			else
+				changedLabels = splitLabel(random, rec, 300 + edit, changedBegin, changedEnd);
+
+			// the changed box might be empty
+			for (int d = 0; d < 3; d++)
+				changedEnd[d] = std::max(changedEnd[d], changedBegin[d]);
+
+			bool byLabels = (random()%2 == 0);
+
+			TolerantEditDistanceErrors errors =
+					(byLabels ?
+					 ted.update(rec, changedLabels) :
+					 ted.update(rec, changedBegin, changedEnd));
+
+			TolerantEditDistance reference(parameters);
+			TolerantEditDistanceErrors expected = reference.compute(gt, rec);
+
+			std::string where =
+					"edit " + std::to_string(edit) +
+					(byLabels ? " by labels" : " by box") +
+					" in round " + std::to_string(round);
+
+			numFailed += compareErrors(errors, expected, where);
+			numFailed += !TED_CHECK(equal(ted.getCorrectedReconstruction(), reference.getCorrectedReconstruction()), where);
+		}
+	}
+
+	return numFailed;
+}
+
+unsigned int
+testTolerantEditDistanceThresholds() {
+
+	std::mt19937 random(42);
+	unsigned int numFailed = 0;
+
+	// how often the ILP of a smaller threshold has fewer variables than the 
+	// one of the largest threshold
+	unsigned int numSmallerIlps = 0;
+
+	for (unsigned int round = 0; round < 30; round++) {
+
+		TolerantEditDistance::Parameters parameters;
+		parameters.fromSkeleton  = (round%2 == 1);
+		parameters.reportFPsFNs  = (random()%2 == 0);
+		parameters.solverBackend = BranchAndBound;
+		parameters.alternativeLabelSearch =
+				(random()%2 == 0 ?
+				 DistanceToleranceFunction::NeighborhoodScan :
+				 DistanceToleranceFunction::DistanceTransform);
+
+		std::vector<unsigned int> thresholds = { 1, 2, 3 };
+
+		std::vector<Seed> gtSeeds = createRandomSeeds(random, 8, 1);
+		ImageStack gt  = createVoronoiStack(gtSeeds);
+		ImageStack rec = createReconstruction(random, gtSeeds);
+
+		TolerantEditDistance sweep(parameters);
+		sweep.setGroundTruth(gt);
+		std::vector<TolerantEditDistanceErrors> errors = sweep.compute(rec, thresholds);
+
+		numFailed += !TED_CHECK(errors.size() == thresholds.size(), "round " + std::to_string(round));
+		if (errors.size() != thresholds.size())
+			continue;
+
+		for (unsigned int i = 0; i < thresholds.size(); i++) {
+
+			parameters.distanceThreshold = thresholds[i];
+
+			TolerantEditDistance reference(parameters);
+			TolerantEditDistanceErrors expected = reference.compute(gt, rec);
+
+			std::string where =
+					"threshold " + std::to_string(thresholds[i]) +
+					(parameters.fromSkeleton ? " for skeletons" : "") +
+					" in round " + std::to_string(round);
+
+			// The sweep starts the ILP of each threshold from the solution of 
+			// the previous one. Between several optimal solutions, it can end 
+			// up in another one than a separate compute(), with another 
+			// number of splits, merges, FPs, and FNs, but not in total.
+			numFailed += !TED_CHECK(errors[i].getNumErrors()    == expected.getNumErrors(),    where);
+			numFailed += !TED_CHECK(errors[i].getLowerBound()   == expected.getLowerBound(),   where);
+			numFailed += !TED_CHECK(errors[i].getNumVariables() == expected.getNumVariables(), where);
+
+			if (errors[i].getNumVariables() < errors.back().getNumVariables())
+				numSmallerIlps++;
+		}
+	}
+
+	numFailed += !TED_CHECK(numSmallerIlps > 0, "no smaller threshold has fewer possible labels");
+
+	return numFailed;
+}
@@ -0,0 +1,24 @@
+#include <iostream>
+#include "tests.h"
+
+int main() {
+
+	unsigned int numFailed = 0;
+
+	numFailed += testTolerantEditDistanceComponent();
+	numFailed += testCellSurface();
+	numFailed += testSurfaceSpanningTree();
+	numFailed += testCellExtraction();
+	numFailed += testTolerantEditDistanceUpdate();
+	numFailed += testTolerantEditDistanceThresholds();
+
+	if (numFailed > 0) {
+
+		std::cerr << numFailed << " checks failed" << std::endl;
+		return 1;
+	}
+
+	std::cout << "all checks passed" << std::endl;
+	return 0;
+}
+
@@ -0,0 +1,71 @@
+#ifndef TED_TESTS_TESTS_H__
+#define TED_TESTS_TESTS_H__
+
+#include <iostream>
+
+/**
+ * Check a condition in a test, and report where it failed. Evaluates to the 
+ * condition, such that tests can count their failures.
+ */
+#define TED_CHECK(condition, message) \
+	((condition) ? true : (std::cerr << __FILE__ << ":" << __LINE__ << ": check '" #condition "' failed: " << message << std::endl, false))
+
+/**
+ * Compare TolerantEditDistanceComponent::solve() against a brute-force 
+ * enumeration of all labelings on small random components.
+ *
+ * @return
+ *             The number of failed checks.
+ */
+unsigned int testTolerantEditDistanceComponent();
+
+/**
+ * Compare CellSurface::findClosestPair() against a comparison of all pairs of 
+ * locations, including the choice between several closest pairs.
+ *
+ * @return
+ *             The number of failed checks.
+ */
+unsigned int testCellSurface();
+
+/**
+ * Compare the weight of the SurfaceSpanningTree of random sets of cells 
+ * against Prim's algorithm on the distances between all pairs of sets.
+ *
+ * @return
+ *             The number of failed checks.
+ */
+unsigned int testSurfaceSpanningTree();
+
+/**
+ * Compare the cells found by the fused and block-wise cell extraction against 
+ * the vigra labeling on random label volumes, for all numbers of slabs and 
+ * with lazy cells.
+ *
+ * @return
+ *             The number of failed checks.
+ */
+unsigned int testCellExtraction();
+
+/**
+ * Apply random merges and splits to a reconstruction, and compare the errors 
+ * and corrected reconstruction of TolerantEditDistance::update() against a 
+ * new compute() after each change.
+ *
+ * @return
+ *             The number of failed checks.
+ */
+unsigned int testTolerantEditDistanceUpdate();
+
+/**
+ * Compare the errors of a sweep over several distance thresholds with 
+ * TolerantEditDistance::compute(reconstruction, thresholds) against a 
+ * separate compute() for each threshold, for volumes and skeletons.
+ *
+ * @return
+ *             The number of failed checks.
+ */
+unsigned int testTolerantEditDistanceThresholds();
+
+#endif // TED_TESTS_TESTS_H__
+